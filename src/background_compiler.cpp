@@ -0,0 +1,125 @@
+#include "background_compiler.h"
+#include "cpu.h"
+
+#ifdef HAS_JIT
+
+#include <chrono>
+
+#define COMPILER_IDLE_WAIT std::chrono::milliseconds(1)
+
+BackgroundCompiler::BackgroundCompiler() : cpu(NULL), stopping(false), inFlight(0)
+{
+}
+
+BackgroundCompiler::BackgroundCompiler(const BackgroundCompiler &other) : cpu(NULL), stopping(false), inFlight(0)
+{
+}
+
+BackgroundCompiler::~BackgroundCompiler()
+{
+  stop();
+}
+
+BackgroundCompiler &BackgroundCompiler::operator=(const BackgroundCompiler &other)
+{
+  stop();
+  return *this;
+}
+
+/*
+ * Hands a block to the compiler thread. Fails without waiting if as many
+ * blocks as the queues hold are still being compiled or waiting to be taken,
+ * so a result always has room to be published.
+ */
+bool BackgroundCompiler::queue(CPU *cpu, Block *block)
+{
+  if (inFlight == COMPILE_QUEUE_SIZE || !requests.push(block))
+  {
+    return false;
+  }
+
+  inFlight++;
+
+  if (!worker.joinable())
+  {
+    this->cpu = cpu;
+    worker = std::thread(&BackgroundCompiler::run, this);
+  }
+
+  // Notifying without the mutex may miss a worker that is about to wait,
+  // but it wakes up again on its own within COMPILER_IDLE_WAIT.
+  wake.notify_one();
+  return true;
+}
+
+/*
+ * The next finished block, or NULL if there is none yet. The caller owns the
+ * result and has to delete it.
+ */
+CompiledCode *BackgroundCompiler::takeResult()
+{
+  CompiledCode *result;
+
+  if (inFlight == 0 || !results.pop(&result))
+  {
+    return NULL;
+  }
+
+  inFlight--;
+  return result;
+}
+
+/*
+ * Joins the compiler thread and drops whatever it had not finished, clearing
+ * the compiling mark so the blocks can be freed.
+ */
+void BackgroundCompiler::stop()
+{
+  if (worker.joinable())
+  {
+    stopping = true;
+    wake.notify_one();
+    worker.join();
+    stopping = false;
+  }
+
+  Block *block;
+  CompiledCode *result;
+
+  while (requests.pop(&block))
+  {
+    block->compiling = false;
+  }
+
+  while (results.pop(&result))
+  {
+    result->block->compiling = false;
+    delete result;
+  }
+
+  inFlight = 0;
+}
+
+void BackgroundCompiler::run()
+{
+  while (!stopping)
+  {
+    Block *block;
+
+    if (!requests.pop(&block))
+    {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+
+      wake.wait_for(lock, COMPILER_IDLE_WAIT);
+      continue;
+    }
+
+    CompiledCode *result = new CompiledCode();
+
+    result->block = block;
+    result->size = cpu->emitBlock(block, result->bytes) - result->bytes;
+    results.push(result);
+  }
+}
+
+#endif
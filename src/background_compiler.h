@@ -0,0 +1,65 @@
+#ifndef BACKGROUND_COMPILER_H
+#define BACKGROUND_COMPILER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "jit.h"
+#include "single_producer_queue.h"
+
+#ifdef HAS_JIT
+
+#define COMPILE_QUEUE_SIZE 64
+
+class CPU;
+struct Block;
+
+/*
+ * Machine code for one block, emitted by the compiler thread into a buffer
+ * of its own. The JIT arena is only writable while nothing runs from it, so
+ * the emulation thread copies the code in between blocks.
+ */
+struct CompiledCode
+{
+  Block *block;
+  size_t size;
+  uint8_t bytes[MAX_COMPILED_BLOCK_SIZE];
+};
+
+/*
+ * Compiles hot blocks on a thread of its own, started when the first block
+ * is queued. The emulation thread queues blocks and collects the results
+ * without taking a lock. A queued block stays alive, even if it is retired,
+ * until its result has been taken. Copying a CPU gives the copy a compiler
+ * of its own that has not started yet.
+ */
+class BackgroundCompiler
+{
+  public:
+    BackgroundCompiler();
+    BackgroundCompiler(const BackgroundCompiler &other);
+    ~BackgroundCompiler();
+    BackgroundCompiler &operator=(const BackgroundCompiler &other);
+    bool queue(CPU *cpu, Block *block);
+    CompiledCode *takeResult();
+    void stop();
+
+  private:
+    CPU *cpu;
+    std::thread worker;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+    size_t inFlight;
+    SingleProducerQueue<Block *, COMPILE_QUEUE_SIZE> requests;
+    SingleProducerQueue<CompiledCode *, COMPILE_QUEUE_SIZE> results;
+    void run();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,343 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "flag_tables.h"
+#include "io.h"
+#include "lockstep.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+#include "space_invaders.h"
+#include "static_code.h"
+#include "status_bits.h"
+
+#define FILE_SIZE 8192
+#define CYCLES_PER_SECOND 2000000
+#define DEFAULT_EMULATED_SECONDS 10
+#define FLAG_BENCHMARK_ROUNDS 50
+#define TOP_INSTRUCTION_PAIRS 20
+
+using namespace std;
+using namespace std::chrono;
+
+double secondsSince(steady_clock::time_point start)
+{
+  return duration_cast<duration<double> >(steady_clock::now() - start).count();
+}
+
+void setUpCPU(CPU *cpu, SpaceInvaders *hardware, uint8_t *rom, CPUCore core, bool lazyFlags, bool skipIdleLoops, bool skipDeadFlags, bool replaceMemoryLoops, bool chainBlocks, bool backgroundCompilation)
+{
+  cpu->core = core;
+  cpu->lazyFlags = lazyFlags;
+  cpu->skipIdleLoops = skipIdleLoops;
+  cpu->skipDeadFlags = skipDeadFlags;
+  cpu->replaceMemoryLoops = replaceMemoryLoops;
+  cpu->chainBlocks = chainBlocks;
+  cpu->backgroundCompilation = backgroundCompilation;
+  cpu->setPortHandler<SpaceInvaders, 0>(hardware);
+  cpu->loadProgram(rom, FILE_SIZE);
+#ifdef HAS_STATIC_INVADERS
+  cpu->setStaticProgram(&invadersStaticProgram);
+#endif
+  hardware->startScreenInterrupts(cpu);
+}
+
+void runROM(uint8_t *rom, CPUCore core, bool lazyFlags, bool skipIdleLoops, bool skipDeadFlags, bool replaceMemoryLoops, bool chainBlocks, bool backgroundCompilation, int emulatedSeconds)
+{
+  SpaceInvaders hardware;
+  CPU cpu;
+  uint64_t targetCycles = (uint64_t)emulatedSeconds * CYCLES_PER_SECOND;
+
+  setUpCPU(&cpu, &hardware, rom, core, lazyFlags, skipIdleLoops, skipDeadFlags, replaceMemoryLoops, chainBlocks, backgroundCompilation);
+
+  steady_clock::time_point start = steady_clock::now();
+
+  cpu.runUntil(targetCycles);
+
+  double seconds = secondsSince(start);
+  uint64_t totalCycles = cpu.elapsedCycles();
+
+  printf("%-10s %8.2f emulated MHz (%llu cycles in %.3f s, %.1f%% idle)\n", (CPU::nameOfCore(core) + (lazyFlags ? " lazy" : "")).c_str(), totalCycles / seconds / 1000000, (unsigned long long)totalCycles, seconds, cpu.elapsedIdleCycles() * 100.0 / totalCycles);
+
+  if (cpu.fault() != NO_FAULT)
+  {
+    printf("%-10s stopped on a fault: %s\n", "", cpu.faultMessage().c_str());
+  }
+}
+
+/*
+ * Runs the ROM on core in lockstep with the switch core, which keeps its
+ * eager flags and every other default, and reports the first divergence.
+ * Returns false if there was one.
+ */
+bool checkROM(uint8_t *rom, CPUCore core, bool lazyFlags, bool skipIdleLoops, bool skipDeadFlags, bool replaceMemoryLoops, bool chainBlocks, bool backgroundCompilation, int emulatedSeconds)
+{
+  SpaceInvaders referenceHardware;
+  SpaceInvaders hardware;
+  CPU reference;
+  CPU cpu;
+  Lockstep lockstep(&reference, &cpu);
+  string name = CPU::nameOfCore(core) + (lazyFlags ? " lazy" : "");
+
+  setUpCPU(&reference, &referenceHardware, rom, SWITCH_CORE, false, true, true, true, true, true);
+  setUpCPU(&cpu, &hardware, rom, core, lazyFlags, skipIdleLoops, skipDeadFlags, replaceMemoryLoops, chainBlocks, backgroundCompilation);
+  lockstep.runUntil((uint64_t)emulatedSeconds * CYCLES_PER_SECOND);
+
+  if (lockstep.diverged())
+  {
+    printf("%-10s diverged %s\n", name.c_str(), lockstep.divergence().c_str());
+    return false;
+  }
+
+  printf("%-10s matches the switch core for %llu cycles\n", name.c_str(), (unsigned long long)cpu.elapsedCycles());
+  return true;
+}
+
+/*
+ * The mnemonic without its operand, e.g. "MVI B" or "JNZ".
+ */
+string opCodeName(uint8_t opCode)
+{
+  string name = opCodeInfo(opCode).mnemonic;
+
+  name = name.substr(0, name.find("0x%"));
+  return name.substr(0, name.find_last_not_of(", ") + 1);
+}
+
+/*
+ * Counts which op code follows which while the ROM runs, to find the pairs
+ * worth fusing. The pairs are listed with the most frequent first.
+ */
+void profileInstructionPairs(uint8_t *rom, int emulatedSeconds)
+{
+  SpaceInvaders hardware;
+  CPU cpu;
+  bool vsync1 = true;
+  uint64_t targetCycles = (uint64_t)emulatedSeconds * CYCLES_PER_SECOND;
+  uint64_t frameEnd = 0;
+  uint64_t instructions = 0;
+  vector<uint64_t> pairCounts(256 * 256);
+  uint8_t previousOpCode = NOP;
+
+  cpu.core = TABLE_CORE;
+  cpu.stepThrough = true;
+  cpu.setPortHandler(&hardware);
+  cpu.loadProgram(rom, FILE_SIZE);
+
+  while (cpu.elapsedCycles() < targetCycles)
+  {
+    frameEnd += CYCLES_PER_SCREEN_INTERRUPT;
+
+    while (cpu.elapsedCycles() < frameEnd)
+    {
+      uint8_t opCode = cpu.memory[cpu.programCounter];
+
+      pairCounts[previousOpCode << 8 | opCode]++;
+      previousOpCode = opCode;
+      instructions++;
+      cpu.processProgram();
+    }
+
+    cpu.handleInterrupt(vsync1 ? RST_1 : RST_2);
+    vsync1 = !vsync1;
+  }
+
+  for (int rank = 0; rank < TOP_INSTRUCTION_PAIRS; rank++)
+  {
+    int top = 0;
+
+    for (int pair = 1; pair < 256 * 256; pair++)
+    {
+      if (pairCounts[pair] > pairCounts[top])
+      {
+        top = pair;
+      }
+    }
+
+    printf("0x%02x 0x%02x %-8s %-8s %6.2f%%\n", top >> 8, top & 0xff, opCodeName(top >> 8).c_str(),
+      opCodeName(top & 0xff).c_str(), pairCounts[top] * 100.0 / instructions);
+    pairCounts[top] = 0;
+  }
+}
+
+/*
+ * Each operation feeds its result into the next, like a chain of ALU
+ * instructions, so the table lookups cannot be vectorised away.
+ */
+void runFlagBenchmark()
+{
+  uint64_t operations = (uint64_t)FLAG_BENCHMARK_ROUNDS * 2 * 256 * 256;
+  uint8_t accumulator = 0;
+  uint32_t computedChecksum = 0;
+  uint32_t tableChecksum = 0;
+
+  initFlagTables();
+
+  steady_clock::time_point start = steady_clock::now();
+
+  for (int round = 0; round < FLAG_BENCHMARK_ROUNDS; round++)
+  {
+    for (int i = 0; i < 256 * 256; i++)
+    {
+      uint16_t sum = computeAddFlags(accumulator, i & 0xff, i >> 8 & 1);
+      uint16_t difference = computeSubtractFlags(FLAG_TABLE_RESULT(sum), i >> 8, FLAG_TABLE_FLAGS(sum) & CARRY_BIT);
+      accumulator = FLAG_TABLE_RESULT(difference);
+      computedChecksum += difference;
+    }
+  }
+
+  double computedSeconds = secondsSince(start);
+  accumulator = 0;
+  start = steady_clock::now();
+
+  for (int round = 0; round < FLAG_BENCHMARK_ROUNDS; round++)
+  {
+    for (int i = 0; i < 256 * 256; i++)
+    {
+      uint16_t sum = addFlagTable[i >> 8 & 1][accumulator][i & 0xff];
+      uint16_t difference = subtractFlagTable[FLAG_TABLE_FLAGS(sum) & CARRY_BIT][FLAG_TABLE_RESULT(sum)][i >> 8];
+      accumulator = FLAG_TABLE_RESULT(difference);
+      tableChecksum += difference;
+    }
+  }
+
+  double tableSeconds = secondsSince(start);
+
+  printf("computed   %8.2f ns per operation\n", computedSeconds * 1e9 / operations);
+  printf("tables     %8.2f ns per operation\n", tableSeconds * 1e9 / operations);
+  printf("checksums %s\n", computedChecksum == tableChecksum ? "match" : "DIFFER");
+}
+
+int main(int argc, char *argv[])
+{
+  string inputFile = "data/invaders.bin";
+  int emulatedSeconds = DEFAULT_EMULATED_SECONDS;
+  bool lazyFlags = false;
+  bool skipIdleLoops = true;
+  bool skipDeadFlags = true;
+  bool replaceMemoryLoops = true;
+  bool chainBlocks = true;
+  bool backgroundCompilation = true;
+  bool profilePairs = false;
+  bool lockstep = false;
+  vector<CPUCore> cores;
+  uint8_t buffer[FILE_SIZE];
+
+  for (int i = 1; i < argc; i++)
+  {
+    CPUCore core;
+
+    if (strcmp(argv[i], "--core") == 0 && i + 1 < argc)
+    {
+      if (!CPU::coreFromName(argv[++i], &core))
+      {
+        printf("Unknown CPU core: %s\n", argv[i]);
+        return 1;
+      }
+
+      cores.push_back(core);
+    }
+    else if (strcmp(argv[i], "--lazy-flags") == 0)
+    {
+      lazyFlags = true;
+    }
+    else if (strcmp(argv[i], "--no-idle-skip") == 0)
+    {
+      skipIdleLoops = false;
+    }
+    else if (strcmp(argv[i], "--keep-dead-flags") == 0)
+    {
+      skipDeadFlags = false;
+    }
+    else if (strcmp(argv[i], "--no-memory-loops") == 0)
+    {
+      replaceMemoryLoops = false;
+    }
+    else if (strcmp(argv[i], "--no-chaining") == 0)
+    {
+      chainBlocks = false;
+    }
+    else if (strcmp(argv[i], "--sync-jit") == 0)
+    {
+      backgroundCompilation = false;
+    }
+    else if (strcmp(argv[i], "--lockstep") == 0)
+    {
+      lockstep = true;
+    }
+    else if (strcmp(argv[i], "--flags") == 0)
+    {
+      runFlagBenchmark();
+      return 0;
+    }
+    else if (strcmp(argv[i], "--pairs") == 0)
+    {
+      profilePairs = true;
+    }
+    else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+    {
+      emulatedSeconds = atoi(argv[++i]);
+    }
+    else
+    {
+      inputFile = argv[i];
+    }
+  }
+
+  if (cores.empty())
+  {
+    cores.push_back(SWITCH_CORE);
+    cores.push_back(TABLE_CORE);
+#ifdef HAS_THREADED_CORE
+    cores.push_back(THREADED_CORE);
+#endif
+    cores.push_back(BLOCK_CORE);
+#ifdef HAS_JIT
+    cores.push_back(JIT_CORE);
+#endif
+#ifdef HAS_STATIC_INVADERS
+    cores.push_back(AOT_CORE);
+#endif
+#ifdef HAS_TRACE_COMPILER
+    cores.push_back(TRACE_CORE);
+#endif
+  }
+
+  memset(buffer, 0, FILE_SIZE);
+
+  if (openFile(inputFile, buffer, FILE_SIZE) != 0)
+  {
+    printf("Failed to load %s\n", inputFile.c_str());
+    return 1;
+  }
+
+  if (profilePairs)
+  {
+    profileInstructionPairs(buffer, emulatedSeconds);
+    return 0;
+  }
+
+  if (lockstep)
+  {
+    bool allMatch = true;
+
+    for (size_t i = 0; i < cores.size(); i++)
+    {
+      allMatch = checkROM(buffer, cores[i], lazyFlags, skipIdleLoops, skipDeadFlags, replaceMemoryLoops, chainBlocks, backgroundCompilation, emulatedSeconds) && allMatch;
+    }
+
+    return allMatch ? 0 : 1;
+  }
+
+  for (size_t i = 0; i < cores.size(); i++)
+  {
+    runROM(buffer, cores[i], lazyFlags, skipIdleLoops, skipDeadFlags, replaceMemoryLoops, chainBlocks, backgroundCompilation, emulatedSeconds);
+  }
+
+  return 0;
+}
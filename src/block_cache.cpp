@@ -0,0 +1,742 @@
+#include <algorithm>
+#include <cstring>
+
+#include "block_cache.h"
+#include "control_flow.h"
+#include "cpu.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+#include "status_bits.h"
+
+BlockCache::BlockCache() : codeInvalidated(false), generation(0)
+{
+  memset(pages, 0, sizeof(pages));
+  memset(codePages, 0, sizeof(codePages));
+  memset(writeGenerations, 0, sizeof(writeGenerations));
+  memset(clearedGenerations, 0, sizeof(clearedGenerations));
+}
+
+BlockCache::BlockCache(const BlockCache &other) : codeInvalidated(false), generation(0)
+{
+  memset(pages, 0, sizeof(pages));
+  memset(codePages, 0, sizeof(codePages));
+  memset(writeGenerations, 0, sizeof(writeGenerations));
+  memset(clearedGenerations, 0, sizeof(clearedGenerations));
+}
+
+BlockCache::~BlockCache()
+{
+  clear();
+  releaseRetiredBlocks();
+}
+
+BlockCache &BlockCache::operator=(const BlockCache &other)
+{
+  clear();
+  return *this;
+}
+
+void BlockCache::insert(Block *block)
+{
+  uint8_t page = block->address >> 8;
+  uint8_t lastPage = (block->address + block->length - 1) >> 8;
+
+  if (!pages[page])
+  {
+    pages[page] = new Block *[BLOCK_PAGE_SIZE]();
+  }
+
+  pages[page][block->address & 0xff] = block;
+  codePages[page] = true;
+  codePages[lastPage] = true;
+}
+
+void BlockCache::markCode(uint8_t page)
+{
+  codePages[page] = true;
+}
+
+void BlockCache::invalidatePage(uint8_t page)
+{
+  retireBlocksInPage(page);
+  retireBlocksInPage(page - 1);
+  codePages[page] = false;
+  codeInvalidated = true;
+  generation++;
+}
+
+void BlockCache::retireBlocksInPage(uint8_t page)
+{
+  if (!pages[page])
+  {
+    return;
+  }
+
+  for (int i = 0; i < BLOCK_PAGE_SIZE; i++)
+  {
+    if (pages[page][i])
+    {
+      pages[page][i]->retired = true;
+      retiredBlocks.push_back(pages[page][i]);
+      pages[page][i] = NULL;
+    }
+  }
+}
+
+void BlockCache::releaseRetiredBlocks()
+{
+  size_t kept = 0;
+
+  for (size_t i = 0; i < retiredBlocks.size(); i++)
+  {
+    if (retiredBlocks[i]->compiling)
+    {
+      retiredBlocks[kept++] = retiredBlocks[i];
+    }
+    else
+    {
+      delete retiredBlocks[i];
+    }
+  }
+
+  retiredBlocks.resize(kept);
+  codeInvalidated = false;
+}
+
+void BlockCache::clear()
+{
+  for (int page = 0; page < BLOCK_PAGE_COUNT; page++)
+  {
+    retireBlocksInPage(page);
+    delete[] pages[page];
+    pages[page] = NULL;
+  }
+
+  memset(codePages, 0, sizeof(codePages));
+  memcpy(clearedGenerations, writeGenerations, sizeof(clearedGenerations));
+  codeInvalidated = true;
+  generation++;
+}
+
+void CPU::runBlocks()
+{
+  Block *previous = NULL;
+
+  if (prewarmCode && !codeWarmed)
+  {
+    warmCode();
+  }
+
+  do
+  {
+    if (halt)
+    {
+      return;
+    }
+
+    enterPendingInterrupt();
+
+    // Stepping runs exactly one instruction, so it cannot use a block
+    // whose first micro-op may be a fused pair.
+    if (stopAfterInstruction)
+    {
+      executeNextInstruction();
+      previous = NULL;
+      continue;
+    }
+
+#ifdef HAS_JIT
+    if (core == JIT_CORE)
+    {
+      installCompiledBlocks();
+    }
+#endif
+#ifdef HAS_TRACE_COMPILER
+    if (core == TRACE_CORE)
+    {
+      installTraces();
+    }
+#endif
+
+    // The previous block may have been retired, and is about to be freed.
+    if (blockCache.codeInvalidated)
+    {
+      previous = NULL;
+    }
+
+    blockCache.releaseRetiredBlocks();
+
+    if (core == AOT_CORE && runStaticBlock())
+    {
+      previous = NULL;
+      continue;
+    }
+
+    Block *block = nextBlock(chainBlocks ? previous : NULL);
+
+    previous = block;
+
+    if (block->address + block->length > programLength)
+    {
+      executeNextInstruction();
+      previous = NULL;
+    }
+    else if (block->idleLoop && skipIdleLoops && cycleLimit != NO_CYCLE_LIMIT)
+    {
+      executeIdleLoop(block);
+    }
+    else if (block->memoryLoop.kind != NO_MEMORY_LOOP && replaceMemoryLoops && followJumps)
+    {
+      executeMemoryLoop(block);
+    }
+    else
+    {
+      executeBlock(block);
+    }
+  }
+  while (continueProgram());
+}
+
+/*
+ * Finds the block at the program counter, starting from the links of the
+ * block that ran before it. A block that made a call pushes the return
+ * address, read back from the guest stack, and the block there onto a
+ * shadow return stack, so the block after a return comes from the top of
+ * that stack. A return that does not match the top, such as the end of an
+ * interrupt handler, leaves the stack alone.
+ */
+Block *CPU::nextBlock(Block *previous)
+{
+  Block *block = NULL;
+
+  if (previous)
+  {
+    if (previous->linkGeneration != blockCache.generation)
+    {
+      memset(previous->links, 0, sizeof(previous->links));
+      previous->linkGeneration = blockCache.generation;
+    }
+
+    if (previous->endsWithCall && programCounter != (uint16_t)(previous->address + previous->length))
+    {
+      ReturnPrediction &entry = returnStack[++returnStackTop % RETURN_STACK_SIZE];
+
+      entry.address = readWord(stackPointer);
+      entry.block = blockCache.blockAt(entry.address);
+      entry.generation = blockCache.generation;
+    }
+    else if (previous->endsWithReturn)
+    {
+      ReturnPrediction &entry = returnStack[returnStackTop % RETURN_STACK_SIZE];
+
+      if (entry.address == programCounter)
+      {
+        returnStackTop--;
+        block = entry.generation == blockCache.generation ? entry.block : NULL;
+      }
+    }
+
+    for (int i = 0; !block && i < BLOCK_LINKS; i++)
+    {
+      if (previous->links[i] && previous->links[i]->address == programCounter)
+      {
+        block = previous->links[i];
+      }
+    }
+
+    if (block)
+    {
+      return block;
+    }
+  }
+
+  block = blockCache.blockAt(programCounter);
+
+  if (!block)
+  {
+    block = decodeBlock(programCounter);
+    blockCache.insert(block);
+  }
+
+  if (previous && !previous->endsWithReturn)
+  {
+    memmove(previous->links + 1, previous->links, (BLOCK_LINKS - 1) * sizeof(Block *));
+    previous->links[0] = block;
+  }
+
+  return block;
+}
+
+Block *CPU::decodeBlock(uint16_t address)
+{
+  Block *block = new Block();
+  uint16_t pc = address;
+
+  block->address = address;
+  block->cycles = 0;
+  block->executions = 0;
+  block->compiling = false;
+  block->retired = false;
+  block->code = NULL;
+  block->trace = NULL;
+  block->linkGeneration = blockCache.generation;
+  memset(block->links, 0, sizeof(block->links));
+
+  do
+  {
+    MicroOp op;
+
+    op.opCode = memory[pc];
+    op.operand = memory[(uint16_t)(pc + 2)] << 8 | memory[(uint16_t)(pc + 1)];
+    op.handler = instructionTable[op.opCode].handler;
+    op.length = instructionTable[op.opCode].length;
+    op.cycles = instructionTable[op.opCode].cycles;
+
+    block->ops.push_back(op);
+    block->cycles += op.cycles;
+    pc += opCodeInfo(op.opCode).length;
+  }
+  while (!endsBlock(block->ops.back().opCode) && block->ops.size() < MAX_BLOCK_INSTRUCTIONS && (uint16_t)(pc - address) + 3 < BLOCK_PAGE_SIZE);
+
+  block->length = (uint16_t)(pc - address);
+  block->endsWithCall = (opCodeInfo(block->ops.back().opCode).attributes & (OP_CODE_CALL | OP_CODE_RESTART)) != 0;
+  block->endsWithReturn = (opCodeInfo(block->ops.back().opCode).attributes & OP_CODE_RETURN) != 0;
+  block->idleLoop = isIdleLoop(block);
+  findMemoryLoop(block);
+
+  if (skipDeadFlags)
+  {
+    removeDeadFlagUpdates(block);
+  }
+
+  if (fuseInstructions)
+  {
+    fuseMicroOps(block);
+  }
+
+  return block;
+}
+
+/*
+ * Decodes a block at every leader the control flow analysis of the loaded
+ * program finds from the reset and RST vectors, so the first frames find
+ * their blocks in the cache instead of decoding them as they go. A block cut
+ * short by its size is followed by the one the block core would decode
+ * next. runBlocks() calls it once after each loadProgram(), with the core
+ * and options of that run, unless prewarmCode is off. Returns the number of
+ * blocks decoded.
+ */
+size_t CPU::warmCode()
+{
+  ControlFlowGraph graph(memory.data(), programLength);
+  size_t decoded = 0;
+
+  codeWarmed = true;
+  graph.explore(ControlFlowGraph::resetEntries());
+
+  for (map<uint32_t, BasicBlock>::const_iterator it = graph.blocks.begin(); it != graph.blocks.end(); ++it)
+  {
+    uint16_t address = it->first;
+
+    while (!blockCache.blockAt(address))
+    {
+      Block *block = decodeBlock(address);
+
+      blockCache.insert(block);
+      decoded++;
+
+      if (endsBlock(block->ops.back().opCode) || block->address + block->length >= programLength)
+      {
+        break;
+      }
+
+      address = block->address + block->length;
+    }
+  }
+
+  return decoded;
+}
+
+/*
+ * Walks the block backwards, tracking which flags something later may still
+ * read, and gives each instruction whose flag results are all overwritten
+ * first a handler that leaves the status register alone. Whatever runs after
+ * the block may read any flag, and so may whatever runs after a store or
+ * IN or OUT, since a store into decoded code or a missing port handler ends
+ * the block early. This runs before fusion, which matches on the original
+ * handlers.
+ */
+void CPU::removeDeadFlagUpdates(Block *block)
+{
+  uint8_t live = ALU_FLAG_BITS;
+
+  for (size_t i = block->ops.size(); i-- > 0;)
+  {
+    MicroOp &op = block->ops[i];
+    const OpCodeInfo &info = opCodeInfo(op.opCode);
+
+    if (info.attributes & (OP_CODE_WRITES_MEMORY | OP_CODE_IO))
+    {
+      live = ALU_FLAG_BITS;
+    }
+
+    if (info.flagsWritten && !(info.flagsWritten & live) && handlerWithoutFlags(op.opCode))
+    {
+      op.handler = handlerWithoutFlags(op.opCode);
+    }
+
+    live = (live & ~info.flagsWritten) | info.flagsRead;
+  }
+}
+
+InstructionHandler CPU::handlerWithoutFlags(uint8_t opCode)
+{
+  InstructionHandler handler = instructionTable[opCode].handler;
+
+  if (handler == &CPU::executeIncrementRegister)
+  {
+    return &CPU::executeIncrementRegisterWithoutFlags;
+  }
+  else if (handler == &CPU::executeDecrementRegister)
+  {
+    return &CPU::executeDecrementRegisterWithoutFlags;
+  }
+  else if (handler == &CPU::executeAddRegisterPairToH || handler == &CPU::executeAddStackPointerToH)
+  {
+    return &CPU::executeAddRegisterPairToHWithoutFlags;
+  }
+  else if (handler == &CPU::executeCompareRegister || handler == &CPU::executeCompareMemory ||
+    handler == &CPU::executeCompareImmediate || handler == &CPU::executeSetCarry || handler == &CPU::executeComplementCarry)
+  {
+    return &CPU::executeNoOperation;
+  }
+  else if ((opCode >= ADD_B && opCode < CMP_B) || ((opCode & 0xc7) == ADI && opCode != CPI))
+  {
+    return &CPU::executeArithmeticWithoutFlags;
+  }
+
+  return NULL;
+}
+
+/*
+ * Replaces common instruction pairs with one micro-op that runs both. The
+ * fused op keeps the combined length and cycles, so the program counter and
+ * cycle count only differ from the unfused ops between the two halves. Only
+ * pairs whose first instruction cannot write memory are fused, since a
+ * write into the second would otherwise need to end the block between them.
+ */
+void CPU::fuseMicroOps(Block *block)
+{
+  vector<MicroOp> fused;
+
+  for (size_t i = 0; i < block->ops.size(); i++)
+  {
+    MicroOp op = block->ops[i];
+
+    if (i + 1 < block->ops.size() && fuseMicroOpPair(&op, block->ops[i + 1]))
+    {
+      i++;
+    }
+
+    fused.push_back(op);
+  }
+
+  block->ops.swap(fused);
+}
+
+bool CPU::fuseMicroOpPair(MicroOp *first, const MicroOp &second)
+{
+  InstructionHandler handler = NULL;
+  uint8_t opCode = first->opCode;
+  uint16_t operand = second.opCode;
+
+  if (first->handler == &CPU::executeDecrementRegister && second.opCode == JNZ)
+  {
+    handler = &CPU::executeDecrementRegisterJumpIfNotZero;
+    operand = second.operand;
+  }
+  else if (first->handler == &CPU::executeMoveRegisterToRegister && second.handler == &CPU::executeIncrementRegisterPair)
+  {
+    handler = &CPU::executeMoveRegisterIncrementRegisterPair;
+  }
+  else if (first->handler == &CPU::executeMoveMemoryToRegister && second.handler == &CPU::executeIncrementRegisterPair)
+  {
+    handler = &CPU::executeMoveMemoryIncrementRegisterPair;
+  }
+  else if (first->handler == &CPU::executeLoadAccumulatorIndirect && second.handler == &CPU::executeStoreAccumulatorIndirect)
+  {
+    handler = &CPU::executeLoadStoreAccumulatorIndirect;
+  }
+  else if (first->handler == &CPU::executeMoveImmediate && second.handler == &CPU::executeOutput)
+  {
+    handler = &CPU::executeMoveImmediateOutput;
+    operand = (second.operand & 0xff) << 8 | (first->operand & 0xff);
+  }
+  else if (first->opCode == CPI && (second.opCode == JZ || second.opCode == JNZ))
+  {
+    handler = second.opCode == JZ ? &CPU::executeCompareImmediateJumpIfZero : &CPU::executeCompareImmediateJumpIfNotZero;
+    opCode = first->operand & 0xff;
+    operand = second.operand;
+  }
+
+  if (!handler)
+  {
+    return false;
+  }
+
+  first->handler = handler;
+  first->opCode = opCode;
+  first->operand = operand;
+  first->length += second.length;
+  first->cycles += second.cycles;
+  return true;
+}
+
+/*
+ * Control transfers, HLT, QUIT, RST and unhandled op codes all end a block,
+ * so every instruction inside one runs in address order.
+ */
+bool CPU::endsBlock(uint8_t opCode)
+{
+  return (opCodeInfo(opCode).attributes & OP_CODE_ENDS_BLOCK) != 0;
+}
+
+bool CPU::isIdleLoop(const Block *block)
+{
+  const MicroOp &last = block->ops.back();
+
+  if (!(opCodeInfo(last.opCode).attributes & OP_CODE_JUMP) || opCodeInfo(last.opCode).length != 3 || last.operand != block->address)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < block->ops.size(); i++)
+  {
+    const OpCodeInfo &info = opCodeInfo(block->ops[i].opCode);
+
+    if ((info.attributes & ~(OP_CODE_JUMP | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY)) || (info.registersWritten & REGISTER_BIT_SP))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Runs one pass of an idle loop. If it jumped back to the start and left the
+ * registers and flags as it found them, every later pass would do the same
+ * until an interrupt, and the caller only raises those once the budget is
+ * spent. The passes that would fit in the budget are counted as idle cycles
+ * instead of being run, so the cycle count ends up where running them would
+ * have left it. Lazy flags are brought up to date on both sides so the
+ * status register can be compared.
+ */
+void CPU::executeIdleLoop(Block *block)
+{
+  uint8_t before[sizeof(registers)];
+
+  materializeFlags();
+  memcpy(before, registers, sizeof(registers));
+  executeBlock(block);
+  materializeFlags();
+
+  if (programCounter != block->address || cycles >= cycleLimit || memcmp(before, registers, sizeof(registers)) != 0)
+  {
+    return;
+  }
+
+  uint64_t passes = (cycleLimit - cycles + block->cycles - 1) / block->cycles;
+
+  cycles += passes * block->cycles;
+  idleCycles += passes * block->cycles;
+}
+
+/*
+ * Matches the copy and fill loops that clear and redraw the screen. The
+ * copy loop is LDAX D, MOV M,A, INX H and INX D in either order, DCR B or
+ * DCR C, and JNZ back to its start. The fill loop is MVI M or MOV M,r, then
+ * INX H, and either DCR of another register or MOV A,H and CPI, before the
+ * JNZ. These run on the original op codes, before fusion changes them.
+ */
+void CPU::findMemoryLoop(Block *block)
+{
+  const vector<MicroOp> &ops = block->ops;
+  MemoryLoop &loop = block->memoryLoop;
+  uint8_t store = ops[0].opCode;
+
+  loop.kind = NO_MEMORY_LOOP;
+  loop.source = REGISTER_M;
+  loop.value = 0;
+  loop.counter = NO_LOOP_COUNTER;
+  loop.endPage = 0;
+
+  if (ops.size() < 4 || ops.back().opCode != JNZ || ops.back().operand != block->address)
+  {
+    return;
+  }
+
+  if (ops.size() == 6 && store == LDX_D && ops[1].opCode == MOV_M_A && (ops[4].opCode == DCR_B || ops[4].opCode == DCR_C) &&
+    ((ops[2].opCode == INX_H && ops[3].opCode == INX_D) || (ops[2].opCode == INX_D && ops[3].opCode == INX_H)))
+  {
+    loop.kind = COPY_LOOP;
+    loop.counter = ops[4].opCode >> 3;
+    return;
+  }
+
+  if (ops[1].opCode != INX_H)
+  {
+    return;
+  }
+
+  if (store == MVI_M)
+  {
+    loop.value = ops[0].operand & 0xff;
+  }
+  else if ((store & 0xf8) == MOV_M_B && (store & 7) != REGISTER_H && (store & 7) != REGISTER_L && (store & 7) != REGISTER_M)
+  {
+    loop.source = store & 7;
+  }
+  else
+  {
+    return;
+  }
+
+  uint8_t counter = ops[2].opCode >> 3 & 7;
+
+  if (ops.size() == 4 && (ops[2].opCode & 0xc7) == DCR_B && counter != REGISTER_H && counter != REGISTER_L &&
+    counter != REGISTER_M && counter != loop.source)
+  {
+    loop.kind = FILL_LOOP;
+    loop.counter = counter;
+  }
+  else if (ops.size() == 5 && ops[2].opCode == MOV_A_H && ops[3].opCode == CPI && loop.source != REGISTER_A)
+  {
+    loop.kind = FILL_LOOP;
+    loop.endPage = ops[3].operand & 0xff;
+  }
+}
+
+/*
+ * How many passes the loop makes before it falls through, or 0 if it would
+ * run past the top of memory first.
+ */
+uint32_t CPU::memoryLoopPasses(const Block *block)
+{
+  const MemoryLoop &loop = block->memoryLoop;
+  uint32_t passes;
+
+  if (loop.counter != NO_LOOP_COUNTER)
+  {
+    passes = *registerFromIndex(loop.counter) ? *registerFromIndex(loop.counter) : 256;
+  }
+  else
+  {
+    passes = registerH < loop.endPage ? (loop.endPage << 8) - currentMemoryAddress() : 0;
+  }
+
+  if (currentMemoryAddress() + passes > memory.size() || (loop.kind == COPY_LOOP && registerPairs[REGISTER_PAIR_D] + passes > memory.size()))
+  {
+    return 0;
+  }
+
+  return passes;
+}
+
+/*
+ * Does all but the last pass of a copy or fill loop with one memmove or
+ * memset, then runs the last pass as a block, so A, the flags and the
+ * program counter end up as the loop leaves them. As with idle loops, only
+ * the passes that fit in the cycle budget are skipped. A loop that stores
+ * into decoded code, or copies forwards onto bytes it has still to read, runs
+ * pass by pass instead.
+ */
+void CPU::executeMemoryLoop(Block *block)
+{
+  const MemoryLoop &loop = block->memoryLoop;
+  uint16_t destination = currentMemoryAddress();
+  uint16_t source = registerPairs[REGISTER_PAIR_D];
+  uint64_t passes = memoryLoopPasses(block);
+
+  if (cycleLimit != NO_CYCLE_LIMIT)
+  {
+    passes = cycles < cycleLimit ? min(passes, (cycleLimit - cycles + block->cycles - 1) / block->cycles) : 0;
+  }
+
+  if (passes < 2 || (loop.kind == COPY_LOOP && source < destination && destination < source + passes))
+  {
+    executeBlock(block);
+    return;
+  }
+
+  uint32_t skipped = passes - 1;
+
+  for (uint32_t page = destination >> 8; page <= (uint32_t)(destination + skipped - 1) >> 8; page++)
+  {
+    if (blockCache.hasCode(page))
+    {
+      executeBlock(block);
+      return;
+    }
+  }
+
+  if (loop.kind == COPY_LOOP)
+  {
+    memmove(&memory[destination], &memory[source], skipped);
+    registerPairs[REGISTER_PAIR_D] += skipped;
+  }
+  else
+  {
+    memset(&memory[destination], loop.source == REGISTER_M ? loop.value : *registerFromIndex(loop.source), skipped);
+  }
+
+  for (uint32_t page = destination >> 8; page <= (uint32_t)(destination + skipped - 1) >> 8; page++)
+  {
+    blockCache.recordWrite(page);
+  }
+
+  registerPairs[REGISTER_PAIR_H] += skipped;
+
+  if (loop.counter != NO_LOOP_COUNTER)
+  {
+    *registerFromIndex(loop.counter) -= skipped;
+  }
+
+  cycles += (uint64_t)skipped * block->cycles;
+  executeBlock(block);
+}
+
+void CPU::executeBlock(Block *block)
+{
+#ifdef HAS_JIT
+  if (core == JIT_CORE && (block->code || (++block->executions == JIT_THRESHOLD && compileHotBlock(block))))
+  {
+    block->code(this);
+    return;
+  }
+#endif
+#ifdef HAS_TRACE_COMPILER
+  if (core == TRACE_CORE && (block->trace || (++block->executions == TRACE_THRESHOLD && compileTrace(block))) && runTrace(block))
+  {
+    return;
+  }
+#endif
+
+  vector<MicroOp>::const_iterator end = block->ops.end();
+
+  for (vector<MicroOp>::const_iterator op = block->ops.begin(); op != end; ++op)
+  {
+    executeMicroOp(*op);
+
+    if (blockCache.codeInvalidated)
+    {
+      return;
+    }
+  }
+}
+
+void CPU::invalidateCode()
+{
+  blockCache.clear();
+  activateStaticCode();
+}
@@ -0,0 +1,163 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "instruction_table.h"
+
+using namespace std;
+
+#define MAX_BLOCK_INSTRUCTIONS 32
+#define BLOCK_PAGE_SIZE 256
+#define BLOCK_PAGE_COUNT 256
+#define NO_LOOP_COUNTER 0xff
+#define BLOCK_LINKS 2
+
+enum MemoryLoopKind
+{
+  NO_MEMORY_LOOP,
+  COPY_LOOP,
+  FILL_LOOP
+};
+
+/*
+ * A decoded instruction. The handler is the same one the table core calls,
+ * with the operand bytes already read from memory.
+ */
+struct MicroOp
+{
+  InstructionHandler handler;
+  uint16_t operand;
+  uint8_t opCode;
+  uint8_t length;
+  uint8_t cycles;
+};
+
+typedef void (*CompiledBlock)(CPU *cpu);
+
+struct Trace;
+
+/*
+ * A block that stores one byte through HL per pass, steps HL on by one and
+ * jumps back to its own start. A copy loop loads the byte through DE and
+ * steps DE too; a fill loop stores register source, or value when source is
+ * REGISTER_M. The loop ends when the counter register reaches zero or, with
+ * NO_LOOP_COUNTER, when H reaches endPage.
+ */
+struct MemoryLoop
+{
+  uint8_t kind;
+  uint8_t source;
+  uint8_t value;
+  uint8_t counter;
+  uint8_t endPage;
+};
+
+/*
+ * A straight-line run of instructions, ending with the first instruction
+ * that can change the program counter or stop the CPU. An idle loop is a
+ * block that jumps back to its own start and cannot write memory, use the
+ * ports or change the stack or interrupts, so while it spins only an
+ * interrupt can change what it reads.
+ *
+ * Links remember the blocks that ran after this one, most recent first, so
+ * the next block is found without a lookup. They are only trusted while
+ * linkGeneration matches the cache's, since a retired block they point to
+ * may already be freed.
+ */
+struct Block
+{
+  uint16_t address;
+  uint16_t length;
+  uint32_t cycles;
+  uint32_t executions;
+  uint32_t linkGeneration;
+  Block *links[BLOCK_LINKS];
+  bool endsWithCall;
+  bool endsWithReturn;
+  bool idleLoop;
+  bool compiling;
+  bool retired;
+  MemoryLoop memoryLoop;
+  CompiledBlock code;
+  const Trace *trace;
+  vector<MicroOp> ops;
+};
+
+/*
+ * Blocks are keyed by the guest address of their first instruction, in one
+ * lazily allocated table per 256-byte page. Every store moves on the write
+ * generation of its page, so code cached from a page, such as a trace or a
+ * static block, can check that the page is unchanged before it runs.
+ * Writing to a page that holds decoded code also retires every block that
+ * starts in that page or in the page before it, since a block never spans
+ * more than two pages. Each retirement moves the cache's generation on,
+ * which breaks every link between blocks. Retired blocks are freed by
+ * releaseRetiredBlocks(), once nothing is executing them and the background
+ * compilers are done with them.
+ */
+class BlockCache
+{
+  public:
+    BlockCache();
+    BlockCache(const BlockCache &other);
+    ~BlockCache();
+    BlockCache &operator=(const BlockCache &other);
+    bool codeInvalidated;
+    uint32_t generation;
+    Block *blockAt(uint16_t address);
+    void insert(Block *block);
+    bool hasCode(uint8_t page);
+    bool pageWritten(uint8_t page);
+    uint64_t writeGeneration(uint8_t page);
+    void recordWrite(uint8_t page);
+    void markCode(uint8_t page);
+    void invalidatePage(uint8_t page);
+    void releaseRetiredBlocks();
+    void clear();
+
+  private:
+    Block **pages[BLOCK_PAGE_COUNT];
+    bool codePages[BLOCK_PAGE_COUNT];
+    uint64_t writeGenerations[BLOCK_PAGE_COUNT];
+    uint64_t clearedGenerations[BLOCK_PAGE_COUNT];
+    vector<Block *> retiredBlocks;
+    void retireBlocksInPage(uint8_t page);
+};
+
+inline Block *BlockCache::blockAt(uint16_t address)
+{
+  Block **page = pages[address >> 8];
+
+  return page ? page[address & 0xff] : NULL;
+}
+
+inline bool BlockCache::hasCode(uint8_t page)
+{
+  return codePages[page];
+}
+
+// Whether the page has been written to since the cache was last cleared.
+inline bool BlockCache::pageWritten(uint8_t page)
+{
+  return writeGenerations[page] != clearedGenerations[page];
+}
+
+inline uint64_t BlockCache::writeGeneration(uint8_t page)
+{
+  return writeGenerations[page];
+}
+
+inline void BlockCache::recordWrite(uint8_t page)
+{
+  writeGenerations[page]++;
+
+  if (codePages[page])
+  {
+    invalidatePage(page);
+  }
+}
+
+#endif
@@ -1,21 +1,27 @@
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <stdio.h>
 #include <string>
 #include <sys/time.h>
 
 #include "cabinet.h"
 #include "io.h"
-#include "op_codes.h"
+#include "static_code.h"
 
 #define FILE_SIZE 8192
 #define SCREEN_WIDTH 224
 #define SCREEN_HEIGHT 256
+#define MAX_CYCLES_PER_PASS (2 * CYCLES_PER_SCREEN_INTERRUPT)
 
 using namespace std;
 using namespace std::chrono;
 
-Cabinet::Cabinet() : renderer(NULL)
+#ifdef HAS_STATIC_INVADERS
+Cabinet::Cabinet() : core(AOT_CORE), lockstep(false), checker(&reference, &cpu), renderer(NULL)
+#else
+Cabinet::Cabinet() : core(CPU::defaultCore), lockstep(false), checker(&reference, &cpu), renderer(NULL)
+#endif
 {
 }
 
@@ -35,6 +41,7 @@ void Cabinet::loadROM()
   if (openFile(inputFile, buffer, FILE_SIZE) == 0) 
   {
     cpu.loadProgram(buffer, FILE_SIZE);
+    reference.loadProgram(buffer, FILE_SIZE);
   }
   else
   {
@@ -43,10 +50,26 @@ void Cabinet::loadROM()
   }
 }
 
+/*
+ * In lockstep the switch core runs the same ROM next to the chosen core, on
+ * hardware of its own that gets the same buttons, and the cabinet stops at
+ * the first divergence.
+ */
 void Cabinet::initCPU()
 {
-  cpu.stepThrough = true;
-  cpu.setPortHandler(&hardware);
+  cpu.core = core;
+  cpu.setPortHandler<SpaceInvaders, 0>(&hardware);
+#ifdef HAS_STATIC_INVADERS
+  cpu.setStaticProgram(&invadersStaticProgram);
+#endif
+  hardware.startScreenInterrupts(&cpu);
+
+  if (lockstep)
+  {
+    reference.core = SWITCH_CORE;
+    reference.setPortHandler<SpaceInvaders, 0>(&referenceHardware);
+    referenceHardware.startScreenInterrupts(&reference);
+  }
 }
 
 void Cabinet::initDisplay()
@@ -87,31 +110,49 @@ void Cabinet::initDisplay()
 void Cabinet::mainLoop()
 {
   bool running = true;
-  bool vsync1 = true;
   SDL_Event event;
-  long long now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
-  long long last = now;
-  long long nextInterrupt = now + 8333;
+  long long start = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+  uint64_t startCycles = cpu.elapsedCycles();
   int cyclesPerMicrosecond = 2;
 
   while (running) 
   {
-    now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    long long now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    uint64_t target = startCycles + (now - start) * cyclesPerMicrosecond;
 
-    if (now > nextInterrupt)
+    // A CPU that cannot keep up, such as one checked in lockstep, runs a
+    // frame per pass and lets the wall clock go. Chasing it would make each
+    // pass longer than the last, and the screen would never be drawn.
+    if (target > cpu.elapsedCycles() + MAX_CYCLES_PER_PASS)
     {
-      cpu.handleInterrupt(vsync1 ? RST_1 : RST_2);
-      vsync1 = !vsync1;
-      nextInterrupt = now + 8333;
+      target = cpu.elapsedCycles() + MAX_CYCLES_PER_PASS;
+      startCycles = target;
+      start = now;
     }
 
-    uint32_t elapsedTime = now - last;
-    uint32_t targetCycles = elapsedTime * cyclesPerMicrosecond;
-    cpu.resetElapsedCycles();
+    // The screen interrupts are scheduled on the CPU's cycle counter, so
+    // keeping the counter in step with the wall clock is all the pacing
+    // needed.
+    if (!lockstep)
+    {
+      cpu.runUntil(target);
+    }
+    else if (checker.runUntil(target) < 0 && checker.diverged())
+    {
+      printf("The %s core diverged %s\n", CPU::nameOfCore(core).c_str(), checker.divergence().c_str());
+      running = false;
+    }
 
-    while (cpu.elapsedCycles() < targetCycles)
+    if (cpu.fault() != NO_FAULT)
     {
-      cpu.processProgram();
+      printf("The CPU stopped on a fault: %s\n", cpu.faultMessage().c_str());
+      running = false;
+    }
+
+    // Nothing happens until the next interrupt wakes a halted CPU.
+    if (cpu.halted() && cpu.nextEventCycle() != NO_EVENT)
+    {
+      SDL_Delay((cpu.nextEventCycle() - cpu.elapsedCycles()) / cyclesPerMicrosecond / 1000);
     }
 
     while (SDL_PollEvent(&event)) 
@@ -125,19 +166,19 @@ void Cabinet::mainLoop()
         switch (event.key.keysym.sym)
         {
           case SDLK_c:
-            hardware.buttonPressed(BUTTON_COIN);
+            buttonPressed(BUTTON_COIN);
             break;
           case SDLK_s:
-            hardware.buttonPressed(BUTTON_START);
+            buttonPressed(BUTTON_START);
             break;
           case SDLK_SPACE:
-            hardware.buttonPressed(BUTTON_SHOOT);
+            buttonPressed(BUTTON_SHOOT);
             break;
           case SDLK_LEFT:
-            hardware.buttonPressed(BUTTON_LEFT);
+            buttonPressed(BUTTON_LEFT);
             break;
           case SDLK_RIGHT:
-            hardware.buttonPressed(BUTTON_RIGHT);
+            buttonPressed(BUTTON_RIGHT);
             break;
         }
       }
@@ -146,19 +187,19 @@ void Cabinet::mainLoop()
         switch (event.key.keysym.sym)
         {
           case SDLK_c:
-            hardware.buttonReleased(BUTTON_COIN);
+            buttonReleased(BUTTON_COIN);
             break;
           case SDLK_s:
-            hardware.buttonReleased(BUTTON_START);
+            buttonReleased(BUTTON_START);
             break;
           case SDLK_SPACE:
-            hardware.buttonReleased(BUTTON_SHOOT);
+            buttonReleased(BUTTON_SHOOT);
             break;
           case SDLK_LEFT:
-            hardware.buttonReleased(BUTTON_LEFT);
+            buttonReleased(BUTTON_LEFT);
             break;
           case SDLK_RIGHT:
-            hardware.buttonReleased(BUTTON_RIGHT);
+            buttonReleased(BUTTON_RIGHT);
             break;
         }
       }
@@ -191,6 +232,25 @@ void Cabinet::mainLoop()
     }
 
     SDL_RenderPresent(renderer);
-    last = now;
+  }
+}
+
+void Cabinet::buttonPressed(uint8_t button)
+{
+  hardware.buttonPressed(button);
+
+  if (lockstep)
+  {
+    referenceHardware.buttonPressed(button);
+  }
+}
+
+void Cabinet::buttonReleased(uint8_t button)
+{
+  hardware.buttonReleased(button);
+
+  if (lockstep)
+  {
+    referenceHardware.buttonReleased(button);
   }
 }
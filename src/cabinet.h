@@ -3,22 +3,31 @@
 
 #include <SDL2/SDL.h>
 
+#include "cpu.h"
+#include "lockstep.h"
 #include "space_invaders.h"
 
 class Cabinet
 {
   public:
     Cabinet();
+    CPUCore core;
+    bool lockstep;
     void bootstrap();
 
   private:
     SpaceInvaders hardware;
     CPU cpu;
+    SpaceInvaders referenceHardware;
+    CPU reference;
+    Lockstep checker;
     SDL_Renderer *renderer;
     void loadROM();
     void initDisplay();
     void initCPU();
     void mainLoop();
+    void buttonPressed(uint8_t button);
+    void buttonReleased(uint8_t button);
 };
 
 #endif
@@ -0,0 +1,269 @@
+#include <algorithm>
+
+#include "control_flow.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+
+ControlFlowGraph::ControlFlowGraph(const uint8_t *code, uint32_t size) : code(code), size(size)
+{
+}
+
+// The reset address and the RST vectors, where an interrupt can enter.
+vector<uint32_t> ControlFlowGraph::resetEntries()
+{
+  vector<uint32_t> entries;
+
+  for (int restart = 0; restart < RESTART_VECTORS; restart++)
+  {
+    entries.push_back(restart * 8);
+  }
+
+  return entries;
+}
+
+/*
+ * Finds the code reachable from the entry points and splits it into basic
+ * blocks. A jump table found in front of a PCHL adds its entries as leaders,
+ * and the search goes on from them until it finds no new ones.
+ */
+void ControlFlowGraph::explore(const vector<uint32_t> &entries)
+{
+  vector<uint32_t> pending(entries);
+  bool newLeaders;
+
+  do
+  {
+    findLeaders(pending);
+    buildBlocks();
+    pending.clear();
+    jumpTables.clear();
+    newLeaders = false;
+
+    for (map<uint32_t, BasicBlock>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+    {
+      JumpTable table;
+
+      if (!findJumpTable(it->second, &table))
+      {
+        continue;
+      }
+
+      for (size_t i = 0; i < table.targets.size(); i++)
+      {
+        uint32_t target = table.targets[i];
+
+        newLeaders |= leaders.insert(target).second;
+        it->second.successors.push_back(target);
+
+        if (!visited.count(target))
+        {
+          pending.push_back(target);
+        }
+      }
+
+      jumpTables.push_back(table);
+    }
+  }
+  while (newLeaders);
+}
+
+bool ControlFlowGraph::fits(uint32_t address)
+{
+  return address < size && address + opCodeInfo(code[address]).length <= size;
+}
+
+// The immediate operand, or 0 for an instruction without one.
+uint16_t ControlFlowGraph::operand(uint32_t address)
+{
+  uint8_t length = opCodeInfo(code[address]).length;
+
+  return (length > 1 ? code[address + 1] : 0) | (length > 2 ? code[address + 2] << 8 : 0);
+}
+
+/*
+ * Where control can go after the instruction at address, other than by an
+ * indirect jump or a return. RST pushes its own address, as an interrupt
+ * does, so it never falls through.
+ */
+void ControlFlowGraph::successors(uint32_t address, vector<uint32_t> *targets, bool *fallsThrough)
+{
+  uint8_t opCode = code[address];
+  const OpCodeInfo &info = opCodeInfo(opCode);
+
+  *fallsThrough = !(info.attributes & (OP_CODE_JUMP | OP_CODE_RETURN | OP_CODE_RESTART | OP_CODE_QUIT | OP_CODE_UNDEFINED)) ||
+    (info.attributes & OP_CODE_CONDITIONAL);
+
+  if ((info.attributes & (OP_CODE_JUMP | OP_CODE_CALL)) && info.length == 3)
+  {
+    targets->push_back(operand(address));
+  }
+  else if (info.attributes & OP_CODE_RESTART)
+  {
+    targets->push_back(opCode & 0x38);
+  }
+}
+
+/*
+ * Walks every instruction reachable from the pending addresses that has not
+ * been walked yet, adding the leaders and call targets it finds.
+ */
+void ControlFlowGraph::findLeaders(vector<uint32_t> pending)
+{
+  leaders.insert(pending.begin(), pending.end());
+
+  while (!pending.empty())
+  {
+    uint32_t address = pending.back();
+
+    pending.pop_back();
+
+    while (fits(address) && visited.insert(address).second)
+    {
+      const OpCodeInfo &info = opCodeInfo(code[address]);
+      vector<uint32_t> targets;
+      bool fallsThrough;
+
+      successors(address, &targets, &fallsThrough);
+
+      for (size_t i = 0; i < targets.size(); i++)
+      {
+        leaders.insert(targets[i]);
+        pending.push_back(targets[i]);
+
+        if (info.attributes & (OP_CODE_CALL | OP_CODE_RESTART))
+        {
+          callTargets.insert(targets[i]);
+        }
+      }
+
+      uint32_t next = address + info.length;
+
+      if (!fallsThrough)
+      {
+        break;
+      }
+
+      if (info.attributes & OP_CODE_ENDS_BLOCK)
+      {
+        leaders.insert(next);
+      }
+
+      address = next;
+    }
+  }
+}
+
+/*
+ * Splits the walked code at the leaders. A block ends at the next leader or
+ * after an instruction that ends a block, and falls through to the address
+ * after it unless that instruction never does.
+ */
+void ControlFlowGraph::buildBlocks()
+{
+  blocks.clear();
+
+  for (set<uint32_t>::const_iterator it = leaders.begin(); it != leaders.end(); ++it)
+  {
+    if (!visited.count(*it))
+    {
+      continue;
+    }
+
+    BasicBlock block;
+    uint32_t address = *it;
+    bool fallsThrough;
+    bool ends;
+
+    block.address = address;
+
+    do
+    {
+      uint16_t attributes = opCodeInfo(code[address]).attributes;
+
+      successors(address, &block.successors, &fallsThrough);
+      ends = !fallsThrough || (attributes & OP_CODE_ENDS_BLOCK);
+      address += opCodeInfo(code[address]).length;
+    }
+    while (!ends && fits(address) && !leaders.count(address));
+
+    if (fallsThrough)
+    {
+      block.successors.push_back(address);
+    }
+
+    block.length = address - block.address;
+    blocks[block.address] = block;
+  }
+}
+
+/*
+ * Looks for the table a block ending in PCHL dispatches through, starting
+ * with the last base address loaded by LXI in the block. A table of JMP
+ * instructions runs for as long as there are JMPs. A table of addresses
+ * stops at the first entry that is not the start of a valid instruction in
+ * the image, at code already found, or where the lowest entry above the
+ * table begins, since the code it points at cannot lie inside it. Guessing
+ * a table that is not there only adds leaders, which is harmless.
+ */
+bool ControlFlowGraph::findJumpTable(const BasicBlock &block, JumpTable *table)
+{
+  vector<uint32_t> bases;
+  uint32_t address = block.address;
+  uint8_t opCode = NOP;
+
+  while (address < block.address + block.length)
+  {
+    opCode = code[address];
+
+    if ((opCode == LXI_B || opCode == LXI_D || opCode == LXI_H) && operand(address) < size)
+    {
+      bases.push_back(operand(address));
+    }
+
+    address += opCodeInfo(opCode).length;
+  }
+
+  if (opCode != PCHL)
+  {
+    return false;
+  }
+
+  for (size_t i = bases.size(); i-- > 0;)
+  {
+    uint32_t base = bases[i];
+    uint32_t end = size;
+
+    table->address = base;
+    table->dispatch = block.address;
+    table->targets.clear();
+
+    for (uint32_t entry = base; code[base] == JMP && fits(entry) && code[entry] == JMP && table->targets.size() < MAX_JUMP_TABLE_ENTRIES; entry += 3)
+    {
+      table->targets.push_back(entry);
+    }
+
+    for (uint32_t entry = base; code[base] != JMP && entry + 1 < end && !visited.count(entry) && table->targets.size() < MAX_JUMP_TABLE_ENTRIES; entry += 2)
+    {
+      uint32_t target = code[entry] | code[entry + 1] << 8;
+
+      if (!fits(target) || (opCodeInfo(code[target]).attributes & OP_CODE_UNDEFINED))
+      {
+        break;
+      }
+
+      if (target > base)
+      {
+        end = min(end, target);
+      }
+
+      table->targets.push_back(target);
+    }
+
+    if (!table->targets.empty())
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
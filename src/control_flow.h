@@ -0,0 +1,68 @@
+#ifndef CONTROL_FLOW_H
+#define CONTROL_FLOW_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#define RESTART_VECTORS 8
+#define MAX_JUMP_TABLE_ENTRIES 64
+
+using namespace std;
+
+/*
+ * A run of instructions that is only entered at its first instruction and
+ * only left after its last. Successors lists where control can go next,
+ * other than by a return, including the entries of the jump table a block
+ * ending in PCHL dispatches through.
+ */
+struct BasicBlock
+{
+  uint32_t address;
+  uint32_t length;
+  vector<uint32_t> successors;
+};
+
+/*
+ * A table of code addresses, or of JMP instructions, whose base is loaded
+ * into a register pair in the block that ends in PCHL.
+ */
+struct JumpTable
+{
+  uint32_t address;
+  uint32_t dispatch;
+  vector<uint32_t> targets;
+};
+
+/*
+ * Recursive-descent disassembly of a code image. Starting at the entry
+ * points, it follows every jump, call and fall-through it can see, and the
+ * jump tables it finds in front of PCHL. Leaders are the addresses some
+ * control transfer can land on, which start a basic block. Other indirect
+ * targets and code outside the image are not found.
+ */
+class ControlFlowGraph
+{
+  public:
+    ControlFlowGraph(const uint8_t *code, uint32_t size);
+    static vector<uint32_t> resetEntries();
+    void explore(const vector<uint32_t> &entries);
+    set<uint32_t> leaders;
+    set<uint32_t> callTargets;
+    map<uint32_t, BasicBlock> blocks;
+    vector<JumpTable> jumpTables;
+
+  private:
+    const uint8_t *code;
+    uint32_t size;
+    set<uint32_t> visited;
+    bool fits(uint32_t address);
+    uint16_t operand(uint32_t address);
+    void successors(uint32_t address, vector<uint32_t> *targets, bool *fallsThrough);
+    void findLeaders(vector<uint32_t> pending);
+    void buildBlocks();
+    bool findJumpTable(const BasicBlock &block, JumpTable *table);
+};
+
+#endif
@@ -1,114 +1,303 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 
 #include "bit_ops.h"
 #include "cpu.h"
+#include "op_code_info.h"
 #include "op_codes.h"
 #include "status_bits.h"
 #include "unhandled_op_code_exception.h"
 
 using namespace std;
 
-#define REGISTER_A 7
-#define REGISTER_B 0
-#define REGISTER_C 1
-#define REGISTER_D 2
-#define REGISTER_E 3
-#define REGISTER_H 4
-#define REGISTER_L 5
-#define REGISTER_M 6
-
-#define REGISTER_PAIR_B 0
-#define REGISTER_PAIR_D 1
-#define REGISTER_PAIR_H 2
-#define REGISTER_PAIR_A 3
-
 #define MAX_MEMORY 65536
 #define NO_INTERRUPT 0xff
 
-CPU::CPU() : followJumps(true), runProgram(true), registerA(0), registerB(0), registerC(0), registerD(0), registerE(0), registerH(0), registerL(0),  stackPointer(MAX_MEMORY), status(0x02), programCounter(0), stepThrough(false), interruptToHandle(NO_INTERRUPT), programLength(0), ignoreInterrupts(false), halt(false), portHandler(NULL), cycles(0)
+#ifdef HAS_THREADED_CORE
+CPUCore CPU::defaultCore = THREADED_CORE;
+#else
+CPUCore CPU::defaultCore = TABLE_CORE;
+#endif
+
+bool CPU::defaultLazyFlags = false;
+
+CPU::CPU() : core(defaultCore), lazyFlags(defaultLazyFlags), followJumps(true), fuseInstructions(true), skipIdleLoops(true), skipDeadFlags(true), replaceMemoryLoops(true), chainBlocks(true), backgroundCompilation(true), prewarmCode(true), traceCacheDirectory(DEFAULT_TRACE_CACHE_DIRECTORY), runProgram(true), stackPointer(0), stackLimit(0), programCounter(0), stepThrough(false), interruptToHandle(NO_INTERRUPT), programLength(0), ignoreInterrupts(false), halt(false), portHandler(NULL), cycles(0), cycleLimit(NO_CYCLE_LIMIT), idleCycles(0), stopAfterInstruction(false), currentFault(NO_FAULT), faultOpCode(0), returnStackTop(0), staticProgram(NULL), staticCodeActive(false), codeWarmed(false), deferredFlagMask(0)
 {
+  initFlagTables();
+  memset(registers, 0, sizeof(registers));
+  memset(returnStack, 0, sizeof(returnStack));
+  status = 0x02;
   memory.resize(MAX_MEMORY);
+#ifdef HAS_THREADED_CORE
+  threadedRunner = &CPU::runThreaded<PortHandler, ALL_CORE_FEATURES>;
+#endif
+}
 
-  registerMap[REGISTER_B] = &registerB;
-  registerMap[REGISTER_C] = &registerC;
-  registerMap[REGISTER_D] = &registerD;
-  registerMap[REGISTER_E] = &registerE;
-  registerMap[REGISTER_H] = &registerH;
-  registerMap[REGISTER_L] = &registerL;
-  registerMap[REGISTER_A] = &registerA;
+bool CPU::coreFromName(string name, CPUCore *core)
+{
+  static const CPUCore cores[7] = { SWITCH_CORE, TABLE_CORE, THREADED_CORE, BLOCK_CORE, JIT_CORE, AOT_CORE, TRACE_CORE };
 
-  registerPairB.push_back(&registerB);
-  registerPairB.push_back(&registerC);
-  registerPairD.push_back(&registerD);
-  registerPairD.push_back(&registerE);
-  registerPairH.push_back(&registerH);
-  registerPairH.push_back(&registerL);
-  registerPairA.push_back(&registerA);
-  registerPairA.push_back(&status);
+  for (int i = 0; i < 7; i++)
+  {
+    if (name == nameOfCore(cores[i]))
+    {
+      *core = cores[i];
+      return true;
+    }
+  }
 
-  registerPairMap[REGISTER_PAIR_B] = &registerPairB;
-  registerPairMap[REGISTER_PAIR_D] = &registerPairD;
-  registerPairMap[REGISTER_PAIR_H] = &registerPairH;
-  registerPairMap[REGISTER_PAIR_A] = &registerPairA;
+  return false;
 }
 
-bool CPU::carryBitSet()
+string CPU::nameOfCore(CPUCore core)
 {
-  return hasFlag(status, CARRY_BIT);
+  switch (core)
+  {
+    case SWITCH_CORE:
+      return "switch";
+    case TABLE_CORE:
+      return "table";
+    case THREADED_CORE:
+      return "threaded";
+    case BLOCK_CORE:
+      return "block";
+    case JIT_CORE:
+      return "jit";
+    case AOT_CORE:
+      return "aot";
+    case TRACE_CORE:
+      return "trace";
+  }
+
+  return "unknown";
 }
 
-bool CPU::parityBitSet()
+void CPU::loadProgram(uint8_t *program, uint16_t programSize)
 {
-  return hasFlag(status, PARITY_BIT);
+  programCounter = 0;
+  programLength = programSize;
+  memcpy(memory.data(), program, programSize);
+  clearFault();
+  invalidateCode();
+  codeWarmed = false;
 }
 
-bool CPU::signBitSet()
+/*
+ * Runs the program, or one instruction when stepping, and throws the fault
+ * if the CPU stops on one. The tests use it to see the faults as
+ * exceptions.
+ */
+void CPU::processProgram()
 {
-  return hasFlag(status, SIGN_BIT);
+  stopAfterInstruction = stepThrough;
+  cycleLimit = NO_CYCLE_LIMIT;
+
+  if (currentFault == NO_FAULT)
+  {
+    runCore();
+  }
+
+  if (currentFault != NO_FAULT)
+  {
+    throwFault();
+  }
+}
+
+/*
+ * Runs instructions until at least budget cycles have passed, ignoring
+ * stepThrough. It also stops on QUIT or at the end of the loaded program,
+ * like processProgram. Returns the cycles run past the budget, which is
+ * negative if it stopped early.
+ *
+ * A halted CPU only wakes for an interrupt, and the caller raises those
+ * between budgets, so the rest of the budget is skipped and counted as idle.
+ *
+ * It never throws. A fault stops the CPU after the instruction that raised
+ * it, and a faulted CPU does not run at all, so a caller only has to check
+ * fault() when less than the budget was run.
+ */
+int64_t CPU::runCycles(uint64_t budget) noexcept
+{
+  uint64_t start = cycles;
+
+  if (currentFault != NO_FAULT)
+  {
+    return -(int64_t)budget;
+  }
+
+  stopAfterInstruction = false;
+  cycleLimit = start + budget;
+  runCore();
+
+  if (halt && cycles < cycleLimit)
+  {
+    idleCycles += cycleLimit - cycles;
+    cycles = cycleLimit;
+  }
+
+  return (int64_t)(cycles - start) - (int64_t)budget;
 }
 
-bool CPU::zeroBitSet()
+/*
+ * Runs until the cycle counter reaches cycle, stopping at each scheduled
+ * event on the way to call its handler. The cores only check the cycle
+ * limit, so events cost nothing between them. Returns the cycles run past
+ * cycle, which is negative if the program ended first.
+ */
+int64_t CPU::runUntil(uint64_t cycle) noexcept
 {
-  return hasFlag(status, ZERO_BIT);
+  dispatchDueEvents();
+
+  while (cycles < cycle)
+  {
+    uint64_t boundary = min(scheduler.nextEventCycle(), cycle);
+
+    if (runCycles(boundary - cycles) < 0)
+    {
+      break;
+    }
+
+    dispatchDueEvents();
+  }
+
+  return (int64_t)(cycles - cycle);
 }
 
-bool CPU::auxiliaryCarryBitSet()
+/*
+ * Records the first fault and stops the CPU once the instruction that
+ * raised it has finished, without the effect that failed: an unhandled op
+ * code is stepped over, IN leaves A alone, OUT writes nothing and a push
+ * that would run below stackLimit is dropped. The cores all stop at the
+ * cycle limit, and blocks, traces and static code stop at codeInvalidated,
+ * which they check after every store.
+ */
+void CPU::raiseFault(CPUFault fault, uint8_t opCode)
 {
-  return hasFlag(status, AUXILIARY_CARRY_BIT);
+  if (currentFault == NO_FAULT)
+  {
+    currentFault = fault;
+    faultOpCode = opCode;
+  }
+
+  cycleLimit = 0;
+  blockCache.codeInvalidated = true;
 }
 
-void CPU::loadProgram(uint8_t *program, uint16_t programSize)
+void CPU::throwFault()
 {
-  programCounter = 0;
-  programLength = programSize;
-  memcpy(memory.data(), program, programSize);
+  if (currentFault == UNHANDLED_OP_CODE_FAULT)
+  {
+    throw UnhandledOpCodeException(faultOpCode);
+  }
+
+  throw runtime_error(faultMessage());
 }
 
-void CPU::processProgram()
+CPUFault CPU::fault()
 {
-  do
+  return currentFault;
+}
+
+string CPU::faultMessage()
+{
+  switch (currentFault)
   {
-    handleNextInstruction();
+    case NO_FAULT:
+      return "";
+    case UNHANDLED_OP_CODE_FAULT:
+      return UnhandledOpCodeException(faultOpCode).what();
+    case NO_INPUT_PORT_HANDLER_FAULT:
+      return "No input port handler attached!";
+    case NO_OUTPUT_PORT_HANDLER_FAULT:
+      return "No output port handler attached!";
+    case STACK_OVERFLOW_FAULT:
+      return "Stack overflow!";
   }
-  while (programCounter < programLength && runProgram && !stepThrough);
+
+  return "Unknown fault";
 }
 
-void CPU::handleNextInstruction()
+/*
+ * Lets a faulted CPU run again from where it stopped.
+ */
+void CPU::clearFault()
 {
-  if (halt)
+  currentFault = NO_FAULT;
+}
+
+void CPU::dispatchDueEvents()
+{
+  ScheduledEvent event;
+
+  while (scheduler.popDueEvent(cycles, &event))
   {
-    return;
+    event.handler->handleEvent(this, event.event, event.cycle);
   }
+}
+
+void CPU::runCore()
+{
+  switch (core)
+  {
+    case SWITCH_CORE:
+      do
+      {
+        handleNextInstruction();
+      }
+      while (continueProgram());
+      break;
+    case THREADED_CORE:
+#ifdef HAS_THREADED_CORE
+      (this->*threadedRunner)();
+      break;
+#endif
+    case TABLE_CORE:
+      do
+      {
+        executeNextInstruction();
+      }
+      while (continueProgram());
+      break;
+    case JIT_CORE:
+    case AOT_CORE:
+    case TRACE_CORE:
+    case BLOCK_CORE:
+      runBlocks();
+      break;
+  }
+
+  materializeFlags();
+}
 
+bool CPU::continueProgram()
+{
+  return programCounter < programLength && runProgram && !stopAfterInstruction && !halt && cycles < cycleLimit;
+}
+
+void CPU::enterPendingInterrupt()
+{
   if (interruptToHandle != NO_INTERRUPT)
   {
     programCounter = interruptToHandle;
     interruptToHandle = NO_INTERRUPT;
     ignoreInterrupts = false;
   }
+}
+
+void CPU::handleNextInstruction()
+{
+  if (halt)
+  {
+    return;
+  }
+
+  enterPendingInterrupt();
+
+  uint8_t opCode = memory[programCounter];
 
-  switch (memory[programCounter])
+  switch (opCode)
   {
     case LXI_B:
     case LXI_D:
@@ -118,8 +307,8 @@ void CPU::handleNextInstruction()
     case LDA:
     case SHLD:
     case LXLD:
-      handle3ByteOp(memory[programCounter], memory[programCounter + 1], memory[programCounter + 2]);
-      programCounter += 3;
+      handle3ByteOp(opCode, memory[programCounter + 1], memory[programCounter + 2]);
+      programCounter += opCodeInfo(opCode).length;
       break;  
     case MVI_B:
     case MVI_C:
@@ -139,12 +328,12 @@ void CPU::handleNextInstruction()
     case CPI:
     case IN:
     case OUT:
-      handle2ByteOp(memory[programCounter], memory[programCounter + 1]);  
-      programCounter += 2;
+      handle2ByteOp(opCode, memory[programCounter + 1]);  
+      programCounter += opCodeInfo(opCode).length;
       break;
     case PCHL:
       programCounter = followJumps ? handleJumpByteOp() : programCounter + 1;
-      cycles += 5;
+      cycles += opCodeInfo(opCode).cycles;
       break;
     case JC:
     case JNC:
@@ -155,7 +344,7 @@ void CPU::handleNextInstruction()
     case JP:
     case JPE:
     case JPO:
-      programCounter = followJumps ? handleJump3ByteOp(memory[programCounter], memory[programCounter + 1], memory[programCounter + 2]) : programCounter + 3;
+      programCounter = followJumps ? handleJump3ByteOp(opCode, memory[programCounter + 1], memory[programCounter + 2]) : programCounter + 3;
       break;
     case CALL:
     case CC:
@@ -166,7 +355,7 @@ void CPU::handleNextInstruction()
     case CP:
     case CPE:
     case CPO:
-      programCounter = followJumps ? handleCall3ByteOp(memory[programCounter], memory[programCounter + 1], memory[programCounter + 2]) : programCounter + 3;
+      programCounter = followJumps ? handleCall3ByteOp(opCode, memory[programCounter + 1], memory[programCounter + 2]) : programCounter + 3;
       break;
     case RET:
     case RC:
@@ -177,7 +366,7 @@ void CPU::handleNextInstruction()
     case RP:
     case RPE:
     case RPO:
-      programCounter = followJumps ? handleReturnOp(memory[programCounter]) : programCounter + 1;
+      programCounter = followJumps ? handleReturnOp(opCode) : programCounter + 1;
       break;
     case QUIT:
       runProgram = false;
@@ -190,10 +379,10 @@ void CPU::handleNextInstruction()
     case RST_5:
     case RST_6:
     case RST_7:
-      handleInterrupt(memory[programCounter]);
+      handleInterrupt(opCode);
       break;
     default:
-      handleByteOp(memory[programCounter]);
+      handleByteOp(opCode);
       programCounter++;
       break;
   }
@@ -201,6 +390,8 @@ void CPU::handleNextInstruction()
 
 void CPU::handleByteOp(uint8_t opCode)
 {
+  cycles += opCodeInfo(opCode).cycles;
+
   switch (opCode)
   {
       case MOV_B_B:
@@ -211,87 +402,66 @@ void CPU::handleByteOp(uint8_t opCode)
       case MOV_L_L:
       case MOV_A_A:
       case NOP:
-        cycles += 4;
         break;
       case INR_B:
         incrementRegister(&registerB);
-        cycles += 5;
         break;  
       case INR_C:
         incrementRegister(&registerC);
-        cycles += 5;
         break;  
       case INR_D:
         incrementRegister(&registerD);
-        cycles += 5;
         break;  
       case INR_E:
         incrementRegister(&registerE);
-        cycles += 5;
         break;  
       case INR_H:
         incrementRegister(&registerH);
-        cycles += 5;
         break;  
       case INR_L:
         incrementRegister(&registerL);
-        cycles += 5;
         break;  
       case INR_A:
         incrementRegister(&registerA);
-        cycles += 5;
         break;  
       case INR_M:
         incrementRegisterM();
-        cycles += 10;
         break;  
       case STC:
         setStatus(CARRY_BIT);
-        cycles += 4;
         break;
       case DCR_B:
         decrementRegister(&registerB);
-        cycles += 5;
         break;
       case DCR_C:
         decrementRegister(&registerC);
-        cycles += 5;
         break;
       case DCR_D:
         decrementRegister(&registerD);
-        cycles += 5;
         break;
       case DCR_E:
         decrementRegister(&registerE);
-        cycles += 5;
         break;
       case DCR_H:
         decrementRegister(&registerH);
-        cycles += 5;
         break;
       case DCR_L:
         decrementRegister(&registerL);
-        cycles += 5;
         break;
       case DCR_A:
         decrementRegister(&registerA);
-        cycles += 5;
         break;
       case DCR_M:
         decrementRegisterM();
-        cycles += 10;
         break;
       case CMC:
         flipStatusBit(CARRY_BIT);
-        cycles += 4;
         break;
       case CMA:
         complimentAccumulator();
-        cycles += 4;
         break;
       case DAA:
         decimalAdjustAccumulator();  
-        cycles += 4;
         break;
       case MOV_B_C:
       case MOV_B_D:
@@ -353,19 +523,15 @@ void CPU::handleByteOp(uint8_t opCode)
         break;  
       case LDX_B:
         moveMemoryToAccumulator(registerB, registerC);  
-        cycles += 7;
         break;
       case LDX_D:
         moveMemoryToAccumulator(registerD, registerE);  
-        cycles += 7;
         break;
       case STAX_B:
         moveAccumulatorToMemory(registerB, registerC);  
-        cycles += 7;
         break;
       case STAX_D:
         moveAccumulatorToMemory(registerD, registerE);  
-        cycles += 7;
         break;
       case ADD_B:
       case ADD_C:
@@ -374,12 +540,10 @@ void CPU::handleByteOp(uint8_t opCode)
       case ADD_H:
       case ADD_L:
       case ADD_A:
-        addValueToAccumulator(*registerMap[opCode & 7], 0);
-        cycles += 4;
+        addValueToAccumulator(registerValueFromOpCode(opCode), 0);
         break;
       case ADD_M:
         addValueToAccumulator(registerM(), 0);
-        cycles += 7;
         break;
       case ADC_B:
       case ADC_C:
@@ -389,11 +553,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case ADC_L:
       case ADC_A:
         addValueToAccumulator(registerValueFromOpCode(opCode), carryBitSet() ? 1 : 0);
-        cycles += 4;
         break;
       case ADC_M:
         addValueToAccumulator(registerM(), carryBitSet() ? 1 : 0);
-        cycles += 7;
         break;
       case SUB_B:
       case SUB_C:
@@ -403,11 +565,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case SUB_L:
       case SUB_A:
         subtractValueFromAccumulator(registerValueFromOpCode(opCode));
-        cycles += 4;
         break;  
       case SUB_M:
         subtractValueFromAccumulator(registerM());
-        cycles += 7;
         break;
       case SBB_B:
       case SBB_C:
@@ -417,11 +577,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case SBB_L:
       case SBB_A:
         subtractValueFromAccumulator(registerValueFromOpCode(opCode) + (carryBitSet() ? 1 : 0));
-        cycles += 4;
         break;
       case SBB_M:
         subtractValueFromAccumulator(registerM() + (carryBitSet() ? 1 : 0));
-        cycles += 7;
         break;
       case ANA_B:
       case ANA_C:
@@ -431,11 +589,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case ANA_L:
       case ANA_A:
         logicalANDWithAccumulator(registerValueFromOpCode(opCode));  
-        cycles += 4;
         break;
       case ANA_M:
         logicalANDWithAccumulator(registerM());  
-        cycles += 7;
         break;
       case XRA_B:
       case XRA_C:
@@ -445,11 +601,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case XRA_L:
       case XRA_A:
         logicalXORWithAccumulator(registerValueFromOpCode(opCode));  
-        cycles += 4;
         break;
       case XRA_M:
         logicalXORWithAccumulator(registerM());
-        cycles += 7;
         break;
       case ORA_B:
       case ORA_C:
@@ -459,11 +613,9 @@ void CPU::handleByteOp(uint8_t opCode)
       case ORA_L:
       case ORA_A:
         logicalORWithAccumulator(registerValueFromOpCode(opCode));  
-        cycles += 4;
         break;
       case ORA_M:
         logicalORWithAccumulator(registerM());
-        cycles += 7;
         break;
       case CMP_B:
       case CMP_C:
@@ -473,123 +625,133 @@ void CPU::handleByteOp(uint8_t opCode)
       case CMP_L:
       case CMP_A:
         compareValueToAccumulator(registerValueFromOpCode(opCode));
-        cycles += 4;
         break;
       case CMP_M:  
         compareValueToAccumulator(registerM());
-        cycles += 7;
         break;
       case RLC:
         rotateAccumulatorLeft();
-        cycles += 4;
         break;  
       case RRC:
         rotateAccumulatorRight();
-        cycles += 4;
         break;
       case RAL:
         rotateAccumulatorLeftWithCarry();
-        cycles += 4;
         break;  
       case RAR:
         rotateAccumulatorRightWithCarry();
-        cycles += 4;
         break;  
       case PUSH_B:
       case PUSH_D:
       case PUSH_H:
-      case PUSH_PSW:  
         pushRegisterPairOnStack(registerPairFromOpCode(opCode));
-        cycles += 11;
+        break; 
+      case PUSH_PSW:  
+        pushAccumulatorAndStatusPairOnStack();
         break; 
       case POP_B:
       case POP_D:
       case POP_H:
         popStackToRegisterPair(registerPairFromOpCode(opCode));
-        cycles += 10;
         break;
       case POP_PSW:
         popStackToAccumulatorAndStatusPair();
-        cycles += 10;
         break;
       case DAD_B:
       case DAD_D:
       case DAD_H:
         addValueToRegisterPairH(valueOfRegisterPair(registerPairFromOpCode(opCode)));  
-        cycles += 10;
         break;
       case DAD_SP:
         addValueToRegisterPairH(stackPointer);
-        cycles += 10;
         break;
       case INX_B:
       case INX_D:
       case INX_H:
         incrementRegisterPair(registerPairFromOpCode(opCode));
-        cycles += 5;
         break;  
       case INX_SP:
         stackPointer++;
-        cycles += 5;
         break;  
       case DCX_B:  
       case DCX_D:  
       case DCX_H:  
         decrementRegisterPair(registerPairFromOpCode(opCode));
-        cycles += 5;
         break;
       case DCX_SP:
         stackPointer--;
-        cycles += 5;
         break;
       case XCHG:
-        exchangeRegisterPairs(registerPairMap[REGISTER_PAIR_D], registerPairMap[REGISTER_PAIR_H]);  
-        cycles += 4;
+        exchangeRegisterPairs(&registerPairs[REGISTER_PAIR_D], &registerPairs[REGISTER_PAIR_H]);  
         break;
       case XTHL:
         exchangeRegistersAndMemory();
-        cycles += 18;
         break;
       case SPHL:
         stackPointer = registerH << 8 | registerL;
-        cycles += 5;
         break;
       case DI:
         ignoreInterrupts = true;
-        cycles += 4;
         break;
       case EI:
         ignoreInterrupts = false;
-        cycles += 4;
         break;
       case HLT:
         halt = true;
-        cycles += 7;
         break;
       default:
-        throw UnhandledOpCodeException(opCode);
+        raiseFault(UNHANDLED_OP_CODE_FAULT, opCode);
         break;  
   }
 }
 
+void CPU::resolveDeferredFlags()
+{
+  uint8_t flags = 0;
+
+  switch (deferredFlagOperation)
+  {
+    case DEFERRED_ADD:
+      flags = FLAG_TABLE_FLAGS(addFlagTable[deferredFlagCarry][deferredFlagOperand][deferredFlagValue]);
+      break;
+    case DEFERRED_SUBTRACT:
+      flags = FLAG_TABLE_FLAGS(subtractFlagTable[deferredFlagCarry][deferredFlagOperand][deferredFlagValue]);
+      break;
+    case DEFERRED_INCREMENT:
+      flags = FLAG_TABLE_FLAGS(addFlagTable[0][deferredFlagOperand][1]);
+      break;
+    case DEFERRED_LOGICAL:
+    case DEFERRED_DECREMENT:
+      flags = szpFlagTable[deferredFlagOperand];
+      break;
+  }
+
+  status = (status & ~deferredFlagMask) | (flags & deferredFlagMask);
+  deferredFlagMask = 0;
+}
+
 void CPU::setStatus(uint8_t bit)
 {
+  materializeFlags();
   setFlag(&(status), bit);
 }
 
 void CPU::clearStatus(uint8_t bit)
 {
+  materializeFlags();
   clearFlag(&(status), bit);
 }
 
 void CPU::flipStatusBit(uint8_t bit)
 {
+  materializeFlags();
   status = (status & bit) ? status & ~bit : status |= bit;
 }
 
 bool CPU::allClear()
 {
-  return status == 0x02 && stackPointer == MAX_MEMORY && registerB == 0 && registerC == 0 &&
+  materializeFlags();
+  return status == 0x02 && stackPointer == 0 && registerB == 0 && registerC == 0 &&
     registerD == 0 && registerE == 0 && registerH == 0 &&
     registerL == 0 && registerA == 0;
 }
@@ -649,7 +811,7 @@ void CPU::incrementRegisterM()
 
   setAuxiliaryCarryBitFromRegisterAndOperand(memory[memory_address], 1);
 
-  memory[memory_address] = sum;
+  writeMemory(memory_address, sum);
   setStatusFromRegister(registerM());
 }
 
@@ -658,20 +820,10 @@ void CPU::decrementRegisterM()
   uint16_t memory_address = currentMemoryAddress();
   uint8_t sum = memory[memory_address] - 1;
 
-  memory[memory_address] = sum;
+  writeMemory(memory_address, sum);
   setStatusFromRegister(registerM());
 }
 
-uint8_t CPU::registerM()
-{
-  return memory[currentMemoryAddress()];
-}
-
-uint16_t CPU::currentMemoryAddress()
-{
-  return registerH << 8 | registerL;
-}
-
 void CPU::complimentAccumulator()
 {
   registerA = ~registerA;
@@ -716,18 +868,15 @@ void CPU::moveRegisterToRegister(uint8_t opCode)
 
   if (dst == REGISTER_M)
   {
-    memory[currentMemoryAddress()] = *registerMap[src];
-    cycles += 7;
+    writeMemory(currentMemoryAddress(), *registerFromIndex(src));
   }
   else if (src == REGISTER_M)
   {
-    *registerMap[dst] = memory[currentMemoryAddress()];
-    cycles += 7;
+    *registerFromIndex(dst) = memory[currentMemoryAddress()];
   }
   else
   {
-    *registerMap[dst] = *registerMap[src];
-    cycles += 5;
+    *registerFromIndex(dst) = *registerFromIndex(src);
   }
 }
 
@@ -738,7 +887,7 @@ void CPU::moveMemoryToAccumulator(uint8_t upperBitsAddress, uint8_t lowerBitsAdd
 
 void CPU::moveAccumulatorToMemory(uint8_t upperBitsAddress, uint8_t lowerBitsAddress)
 {
-  memory[upperBitsAddress << 8 | lowerBitsAddress] = registerA;
+  writeMemory(upperBitsAddress << 8 | lowerBitsAddress, registerA);
 }
 
 void CPU::addValueToAccumulator(uint8_t value, uint8_t carry)
@@ -762,11 +911,6 @@ void CPU::subtractValueFromAccumulator(uint8_t value)
   setStatusFromRegister(registerA);
 }
 
-uint8_t CPU::registerValueFromOpCode(uint8_t opCode)
-{
-  return *registerMap[opCode & 7];
-}
-
 void CPU::logicalANDWithAccumulator(uint8_t value)
 {
   clearStatus(CARRY_BIT);
@@ -828,136 +972,116 @@ void CPU::rotateAccumulatorRightWithCarry()
   registerA |= carrySet ? 1 << CARRY_SHIFT : 0;
 }
 
-vector<uint8_t *> * CPU::registerPairFromOpCode(uint8_t opCode)
+void CPU::pushRegisterPairOnStack(uint16_t *pair)
 {
-  return registerPairMap[(opCode >> 4) & 0x3];
+  push2ByteValueOnStack(*pair);
 }
 
-void CPU::pushRegisterPairOnStack(vector<uint8_t *> * pair)
+void CPU::pushAccumulatorAndStatusPairOnStack()
 {
-  memory[stackPointer - 1] = *((*pair)[0]);
-  memory[stackPointer - 2] = *((*pair)[1]);
-  stackPointer -= 2;
+  materializeFlags();
+  push2ByteValueOnStack(registerA << 8 | status);
 }
 
-void CPU::popStackToRegisterPair(vector<uint8_t *> * pair)
+void CPU::popStackToRegisterPair(uint16_t *pair)
 {
-  *((*pair)[0]) = memory[stackPointer + 1];
-  *((*pair)[1]) = memory[stackPointer];
-  stackPointer += 2;
+  *pair = pop2ByteValueFromStack();
 }
 
 void CPU::popStackToAccumulatorAndStatusPair()
 {
-  registerA = memory[stackPointer + 1];
-  setStatusRegister(memory[stackPointer]);
-  stackPointer += 2;
+  uint16_t value = pop2ByteValueFromStack();
+
+  registerA = value >> 8;
+  setStatusRegister(value & 0xff);
 }
 
 void CPU::setStatusRegister(uint8_t value)
 {
+  deferredFlagMask = 0;
   status = value;
   status |= 0x02;
   status &= 0xd7;
 }
 
-uint16_t CPU::valueOfRegisterPair(vector<uint8_t *> * pair)
+uint16_t CPU::valueOfRegisterPair(uint16_t *pair)
 {
-  return *(*pair)[0] << 8 | *(*pair)[1];
+  return *pair;
 }
 
 void CPU::addValueToRegisterPairH(uint16_t value)
 {
-  vector<uint8_t *> * hlPair = registerPairMap[REGISTER_PAIR_H];
-  uint16_t HLValue = *(*hlPair)[0] << 8 | *(*hlPair)[1];
+  uint16_t HLValue = registerPairs[REGISTER_PAIR_H];
   hasCarryAtBitIndex(HLValue, value, 15) ? setStatus(CARRY_BIT) : clearStatus(CARRY_BIT);
 
-  uint16_t sum = HLValue + value;
-  registerH = sum >> 8;
-  registerL = sum & 0xff;
+  registerPairs[REGISTER_PAIR_H] = HLValue + value;
 }
 
-void CPU::incrementRegisterPair(vector<uint8_t *> * pair)
+void CPU::incrementRegisterPair(uint16_t *pair)
 {
-  uint16_t value = *(*pair)[0] << 8 | *(*pair)[1];
-  value++;
-  *(*pair)[0] = value >> 8;
-  *(*pair)[1] = value & 0xff;
+  (*pair)++;
 }
 
-void CPU::decrementRegisterPair(vector<uint8_t *> * pair)
+void CPU::decrementRegisterPair(uint16_t *pair)
 {
-  uint16_t value = *(*pair)[0] << 8 | *(*pair)[1];
-  value--;
-  *(*pair)[0] = value >> 8;
-  *(*pair)[1] = value & 0xff;
+  (*pair)--;
 }
 
-void CPU::exchangeRegisterPairs(vector<uint8_t *> * p1, vector<uint8_t *> * p2)
+void CPU::exchangeRegisterPairs(uint16_t *p1, uint16_t *p2)
 {
-  uint8_t tempHighBits = *(*p1)[0];
-  uint8_t tempLowBits = *(*p1)[1];
-  *(*p1)[0] = *(*p2)[0];
-  *(*p1)[1] = *(*p2)[1];
-  *(*p2)[0] = tempHighBits;
-  *(*p2)[1] = tempLowBits;
+  uint16_t temp = *p1;
+  *p1 = *p2;
+  *p2 = temp;
 }
 
 void CPU::exchangeRegistersAndMemory()
 {
-  uint8_t tempHighBits = registerL;
-  uint8_t tempLowBits = registerH;
-  registerL = memory[stackPointer];
-  registerH = memory[stackPointer + 1];
-  memory[stackPointer] = tempHighBits;
-  memory[stackPointer + 1] = tempLowBits;
+  uint16_t top = readWord(stackPointer);
+
+  writeWord(stackPointer, registerPairs[REGISTER_PAIR_H]);
+  registerPairs[REGISTER_PAIR_H] = top;
 }
 
 void CPU::handle3ByteOp(uint8_t opCode, uint8_t lowBytes, uint8_t highBytes)
 {
   uint16_t bytes = highBytes << 8 | lowBytes;
 
+  cycles += opCodeInfo(opCode).cycles;
+
   switch (opCode)
   {
     case LXI_B:
     case LXI_D:
     case LXI_H:
       replaceRegisterPair(registerPairFromOpCode(opCode), highBytes, lowBytes);
-      cycles += 10;
       break;
     case LXI_SP:
       stackPointer = bytes;
-      cycles += 10;
       break;
     case STA:
-      memory[bytes] = registerA;
-      cycles += 13;
+      writeMemory(bytes, registerA);
       break;
     case LDA:
       registerA = memory[bytes];
-      cycles += 13;
       break;
     case SHLD:
-      memory[bytes] = registerL;
-      memory[bytes + 1] = registerH;
-      cycles += 16;
+      writeWord(bytes, registerPairs[REGISTER_PAIR_H]);
       break;
     case LXLD:
-      registerL = memory[bytes];
-      registerH = memory[bytes + 1];
-      cycles += 16;
+      registerPairs[REGISTER_PAIR_H] = readWord(bytes);
       break;
   }
 }
 
-void CPU::replaceRegisterPair(vector<uint8_t *> * pair, uint8_t highBytes, uint8_t lowBytes)
+void CPU::replaceRegisterPair(uint16_t *pair, uint8_t highBytes, uint8_t lowBytes)
 {
-  *(*pair)[0] = highBytes;
-  *(*pair)[1] = lowBytes;
+  *pair = highBytes << 8 | lowBytes;
 }
 
 void CPU::handle2ByteOp(uint8_t opCode, uint8_t value)
 {
+  cycles += opCodeInfo(opCode).cycles;
+
   switch (opCode)
   {
     case MVI_B:
@@ -967,52 +1091,40 @@ void CPU::handle2ByteOp(uint8_t opCode, uint8_t value)
     case MVI_H:
     case MVI_L:
     case MVI_A:
-      *(registerMap[opCode >> 3 & 7]) = value;
-      cycles += 7;
+      *registerFromIndex(opCode >> 3 & 7) = value;
       break;
     case MVI_M:
-      memory[currentMemoryAddress()] = value;
-      cycles += 10;
+      writeMemory(currentMemoryAddress(), value);
       break;
     case ADI:
       addValueToAccumulator(value, 0);
-      cycles += 7;
       break;  
     case ACI:
       addValueToAccumulator(value, carryBitSet() ? 1 : 0);
-      cycles += 7;
       break;  
     case SUI:
       subtractValueFromAccumulator(value);
-      cycles += 7;
       break;
     case SBI:
       subtractValueFromAccumulator(value + (carryBitSet() ? 1 : 0));
-      cycles += 7;
       break;
     case ANI:
       logicalANDWithAccumulator(value);
-      cycles += 7;
       break;
     case XRI:
       logicalXORWithAccumulator(value);
-      cycles += 7;
       break;
     case ORI:
       logicalORWithAccumulator(value);
-      cycles += 7;
       break;
     case CPI:
       compareValueToAccumulator(value);  
-      cycles += 7;
       break;
     case IN:
       handleInputFromPort(memory[programCounter + 1]);
-      cycles += 10;
       break;
     case OUT:
       handleOutputToPort(memory[programCounter + 1]);
-      cycles += 10;
       break;
   }
 }
@@ -1059,63 +1171,64 @@ uint16_t CPU::handleJump3ByteOp(uint8_t opCode, uint8_t lowBytes, uint8_t highBy
       break;
   }
 
-  cycles += 10;
+  cycles += opCodeInfo(opCode).cycles;
   return jumpMemoryLocation;
 }
 
+/*
+ * The stack pointer is 16 bits and starts at 0, so the first push wraps
+ * round to the top of memory, as on the 8080.
+ */
 void CPU::push2ByteValueOnStack(uint16_t value)
 {
-  memory[stackPointer - 1] = value >> 8;
-  memory[stackPointer - 2] = value & 0xff;
+  if ((uint16_t)(stackPointer - 2) < stackLimit)
+  {
+    raiseFault(STACK_OVERFLOW_FAULT, 0);
+    return;
+  }
+
   stackPointer -= 2;
+  writeWord(stackPointer, value);
 }
 
 uint16_t CPU::handleCall3ByteOp(uint8_t opCode, uint8_t lowBytes, uint8_t highBytes)
 {
   uint16_t bytes = highBytes << 8 | lowBytes;
-  uint16_t jumpMemoryLocation = 0;
+  bool taken = false;
 
   switch (opCode)
   {
     case CALL:
-      jumpMemoryLocation = performCallOperation(bytes);
-      cycles += 17;
+      taken = true;
       break;
     case CC:
-      jumpMemoryLocation = carryBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += carryBitSet() ? 17 : 11;
+      taken = carryBitSet();
       break;
     case CNC:
-      jumpMemoryLocation = !carryBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += !carryBitSet() ? 17 : 11;
+      taken = !carryBitSet();
       break;
     case CZ:
-      jumpMemoryLocation = zeroBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += zeroBitSet() ? 17 : 11;
+      taken = zeroBitSet();
       break;
     case CNZ:
-      jumpMemoryLocation = !zeroBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += !zeroBitSet() ? 17 : 11;
+      taken = !zeroBitSet();
       break;
     case CM:
-      jumpMemoryLocation = signBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += signBitSet() ? 17 : 11;
+      taken = signBitSet();
       break;
     case CP:
-      jumpMemoryLocation = !signBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += !signBitSet() ? 17 : 11;
+      taken = !signBitSet();
       break;
     case CPE:
-      jumpMemoryLocation = parityBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += parityBitSet() ? 17 : 11;
+      taken = parityBitSet();
       break;
     case CPO:
-      jumpMemoryLocation = !parityBitSet() ? performCallOperation(bytes) : programCounter + 3;
-      cycles += !parityBitSet() ? 17 : 11;
+      taken = !parityBitSet();
       break;
   }
 
-  return jumpMemoryLocation;
+  cycles += taken ? opCodeInfo(opCode).takenCycles : opCodeInfo(opCode).cycles;
+  return taken ? performCallOperation(bytes) : programCounter + 3;
 }
 
 uint16_t CPU::performCallOperation(uint16_t memoryOffset)
@@ -1126,58 +1239,49 @@ uint16_t CPU::performCallOperation(uint16_t memoryOffset)
 
 uint16_t CPU::handleReturnOp(uint8_t opCode)
 {
-  uint16_t jumpMemoryLocation = 0;
+  bool taken = false;
 
   switch (opCode)
   {
     case RET:
-      jumpMemoryLocation = pop2ByteValueFromStack();
-      cycles += 10;
+      taken = true;
       break;
     case RC:
-      jumpMemoryLocation = carryBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += carryBitSet() ? 11 : 5;
+      taken = carryBitSet();
       break;
     case RNC:
-      jumpMemoryLocation = !carryBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += !carryBitSet() ? 11 : 5;
+      taken = !carryBitSet();
       break;
     case RZ:
-      jumpMemoryLocation = zeroBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += zeroBitSet() ? 11 : 5;
+      taken = zeroBitSet();
       break;
     case RNZ:
-      jumpMemoryLocation = !zeroBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += !zeroBitSet() ? 11 : 5;
+      taken = !zeroBitSet();
       break;
     case RM:
-      jumpMemoryLocation = signBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += signBitSet() ? 11 : 5;
+      taken = signBitSet();
       break;
     case RP:
-      jumpMemoryLocation = !signBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += !signBitSet() ? 11 : 5;
+      taken = !signBitSet();
       break;
     case RPE:
-      jumpMemoryLocation = parityBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += parityBitSet() ? 11 : 5;
+      taken = parityBitSet();
       break;
     case RPO:
-      jumpMemoryLocation = !parityBitSet() ? pop2ByteValueFromStack() : programCounter + 1;
-      cycles += !parityBitSet() ? 11 : 5;
+      taken = !parityBitSet();
       break;
   }
 
-  return jumpMemoryLocation;
+  cycles += taken ? opCodeInfo(opCode).takenCycles : opCodeInfo(opCode).cycles;
+  return taken ? pop2ByteValueFromStack() : programCounter + 1;
 }
 
 uint16_t CPU::pop2ByteValueFromStack()
 {
-  uint8_t highBits = memory[stackPointer + 1];
-  uint8_t lowBits = memory[stackPointer];
-  stackPointer += 2;
+  uint16_t value = readWord(stackPointer);
 
-  return highBits << 8 | lowBits;
+  stackPointer += 2;
+  return value;
 }
 
 void CPU::handleInterrupt(uint8_t opCode)
@@ -1197,13 +1301,17 @@ void CPU::handleInterrupt(uint8_t opCode)
 void CPU::setPortHandler(PortHandler *handler)
 {
   portHandler = handler;
+#ifdef HAS_THREADED_CORE
+  threadedRunner = &CPU::runThreaded<PortHandler, ALL_CORE_FEATURES>;
+#endif
 }
 
 void CPU::handleInputFromPort(uint8_t portAddress)
 {
   if (!portHandler)
   {
-    throw runtime_error("No input port handler attached!");
+    raiseFault(NO_INPUT_PORT_HANDLER_FAULT, IN);
+    return;
   }
 
   registerA = portHandler->inputPortHandler(portAddress);
@@ -1213,18 +1321,43 @@ void CPU::handleOutputToPort(uint8_t portAddress)
 {
   if (!portHandler)
   {
-    throw runtime_error("No output port handler attached!");
+    raiseFault(NO_OUTPUT_PORT_HANDLER_FAULT, OUT);
+    return;
   }
 
   portHandler->outputPortHandler(portAddress, registerA);
 }
 
-uint32_t CPU::elapsedCycles()
+/*
+ * Cycles run since the CPU was created. The counter only ever goes up, so
+ * events can be scheduled at absolute cycles.
+ */
+uint64_t CPU::elapsedCycles()
 {
   return cycles;
 }
 
-void CPU::resetElapsedCycles()
+uint64_t CPU::elapsedIdleCycles()
+{
+  return idleCycles;
+}
+
+bool CPU::halted()
+{
+  return halt;
+}
+
+void CPU::scheduleEvent(uint64_t cycle, EventHandler *handler, uint8_t event)
+{
+  scheduler.schedule(cycle, handler, event);
+}
+
+void CPU::cancelEvents(EventHandler *handler)
+{
+  scheduler.cancel(handler);
+}
+
+uint64_t CPU::nextEventCycle()
 {
-  cycles = 0;
+  return scheduler.nextEventCycle();
 }
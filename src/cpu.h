@@ -1,51 +1,189 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include "background_compiler.h"
+#include "block_cache.h"
+#include "flag_tables.h"
+#include "instruction_table.h"
+#include "jit.h"
 #include "port_handler.h"
+#include "scheduler.h"
+#include "status_bits.h"
+#include "threaded_core.h"
+#include "trace_compiler.h"
 #include <cstdint>
-#include <map>
+#include <cstring>
+#include <string>
 #include <vector>
 
 using namespace std;
 
+#define REGISTER_A 7
+#define REGISTER_B 0
+#define REGISTER_C 1
+#define REGISTER_D 2
+#define REGISTER_E 3
+#define REGISTER_H 4
+#define REGISTER_L 5
+#define REGISTER_M 6
+
+#define REGISTER_PAIR_B 0
+#define REGISTER_PAIR_D 1
+#define REGISTER_PAIR_H 2
+#define REGISTER_PAIR_A 3
+
+/*
+ * The register file keeps each pair in host byte order so BC, DE and HL can
+ * be read and written as one 16-bit value. On little-endian hosts the low
+ * register of a pair comes first, so the 3-bit register field of an op code
+ * is flipped in its lowest bit to index the file. The fourth pair holds the
+ * accumulator and status the other way around, so PSW is pushed and popped
+ * explicitly.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REGISTER_FILE_BIG_ENDIAN
+#define REGISTER_INDEX_SWAP 0
+#else
+#define REGISTER_INDEX_SWAP 1
+#endif
+
+// Features a specialised threaded core keeps. Without CORE_FEATURE_STEPPING
+// it ignores stepThrough, and without CORE_FEATURE_TEST_HOOKS it ignores
+// followJumps, QUIT and the end of the loaded program, so it only returns
+// on HLT, at the end of a runCycles budget or, when stepping, after each
+// instruction.
+#define CORE_FEATURE_STEPPING 0x01
+#define CORE_FEATURE_TEST_HOOKS 0x02
+#define ALL_CORE_FEATURES (CORE_FEATURE_STEPPING | CORE_FEATURE_TEST_HOOKS)
+
+#define NO_CYCLE_LIMIT UINT64_MAX
+
+enum CPUCore
+{
+  SWITCH_CORE,
+  TABLE_CORE,
+  THREADED_CORE,
+  BLOCK_CORE,
+  JIT_CORE,
+  AOT_CORE,
+  TRACE_CORE
+};
+
+/*
+ * Why a CPU stopped. A fault is sticky: the CPU does not run again until
+ * clearFault() or loadProgram().
+ */
+enum CPUFault
+{
+  NO_FAULT,
+  UNHANDLED_OP_CODE_FAULT,
+  NO_INPUT_PORT_HANDLER_FAULT,
+  NO_OUTPUT_PORT_HANDLER_FAULT,
+  STACK_OVERFLOW_FAULT
+};
+
+#define RETURN_STACK_SIZE 16
+
+struct StaticBlock;
+struct StaticProgram;
+
+/*
+ * Where the guest is expected to return to after a call, and the block it
+ * will find there, valid for one generation of the block cache.
+ */
+struct ReturnPrediction
+{
+  uint16_t address;
+  Block *block;
+  uint32_t generation;
+};
+
 class CPU
 {
+  friend class BackgroundCompiler;
+  friend class Lockstep;
+  friend class StaticCode;
+
   public:
     CPU();
+    static CPUCore defaultCore;
+    static bool coreFromName(string name, CPUCore *core);
+    static string nameOfCore(CPUCore core);
+    static bool defaultLazyFlags;
+    CPUCore core;
+    bool lazyFlags;
     bool followJumps;
+    bool fuseInstructions;
+    bool skipIdleLoops;
+    bool skipDeadFlags;
+    bool replaceMemoryLoops;
+    bool chainBlocks;
+    bool backgroundCompilation;
+    bool prewarmCode;
+    string traceCacheDirectory;
     bool carryBitSet();
     bool parityBitSet();
     bool signBitSet();
     bool zeroBitSet();
     bool auxiliaryCarryBitSet();
+    uint8_t statusRegister();
     bool allClear();
     bool runProgram;
     void loadProgram(uint8_t *program, uint16_t programSize);
     void processProgram();
-    uint8_t registerA;
-    uint8_t registerB;
-    uint8_t registerC;
-    uint8_t registerD;
-    uint8_t registerE;
-    uint8_t registerH;
-    uint8_t registerL;
+    int64_t runCycles(uint64_t budget) noexcept;
+    void invalidateCode();
+    size_t warmCode();
+    void setStaticProgram(const StaticProgram *program);
+    bool runsStaticCode();
+    size_t loadedTraces();
+    union
+    {
+      uint8_t registers[8];
+      uint16_t registerPairs[4];
+      struct
+      {
+#ifdef REGISTER_FILE_BIG_ENDIAN
+        uint8_t registerB;
+        uint8_t registerC;
+        uint8_t registerD;
+        uint8_t registerE;
+        uint8_t registerH;
+        uint8_t registerL;
+        uint8_t status;
+        uint8_t registerA;
+#else
+        uint8_t registerC;
+        uint8_t registerB;
+        uint8_t registerE;
+        uint8_t registerD;
+        uint8_t registerL;
+        uint8_t registerH;
+        uint8_t registerA;
+        uint8_t status;
+#endif
+      };
+    };
     uint8_t registerM();
-    uint32_t stackPointer;
-    uint8_t status;
+    uint16_t stackPointer;
+    uint16_t stackLimit;
     uint16_t programCounter;
     bool stepThrough;
     uint8_t *executingProgram;
-    vector<uint8_t *> registerPairB;
-    vector<uint8_t *> registerPairD;
-    vector<uint8_t *> registerPairH;
-    vector<uint8_t *> registerPairA;
     vector<uint8_t> memory;
-    map<uint8_t, uint8_t *> registerMap;
-    map<uint8_t, vector<uint8_t *> *> registerPairMap;
     void handleInterrupt(uint8_t opCode);
     void setPortHandler(PortHandler *handler);
-    uint32_t elapsedCycles();
-    void resetElapsedCycles();
+    template <class Ports, unsigned Features> void setPortHandler(Ports *handler);
+    uint64_t elapsedCycles();
+    uint64_t elapsedIdleCycles();
+    bool halted();
+    void scheduleEvent(uint64_t cycle, EventHandler *handler, uint8_t event);
+    void cancelEvents(EventHandler *handler);
+    uint64_t nextEventCycle();
+    int64_t runUntil(uint64_t cycle) noexcept;
+    CPUFault fault();
+    string faultMessage();
+    void clearFault();
 
   private:
     uint8_t interruptToHandle;
@@ -53,7 +191,35 @@ class CPU
     bool ignoreInterrupts;
     bool halt;
     PortHandler *portHandler;
-    uint32_t cycles;
+    uint64_t cycles;
+    uint64_t cycleLimit;
+    uint64_t idleCycles;
+    bool stopAfterInstruction;
+    CPUFault currentFault;
+    uint8_t faultOpCode;
+    Scheduler scheduler;
+    BlockCache blockCache;
+    ReturnPrediction returnStack[RETURN_STACK_SIZE];
+    uint8_t returnStackTop;
+    const StaticProgram *staticProgram;
+    vector<const StaticBlock *> staticBlocks;
+    bool staticCodeActive;
+    bool codeWarmed;
+#ifdef HAS_JIT
+    JitArena jitArena;
+    BackgroundCompiler backgroundCompiler;
+#endif
+#ifdef HAS_TRACE_COMPILER
+    TraceCompiler traceCompiler;
+#endif
+    uint8_t deferredFlagMask;
+    uint8_t deferredFlagOperation;
+    uint8_t deferredFlagOperand;
+    uint8_t deferredFlagValue;
+    uint8_t deferredFlagCarry;
+    void deferFlags(uint8_t operation, uint8_t mask, uint8_t operand, uint8_t value, uint8_t carry);
+    void materializeFlags();
+    void resolveDeferredFlags();
     void handleByteOp(uint8_t opCode);
     void setStatus(uint8_t bit);
     void clearStatus(uint8_t bit);
@@ -77,6 +243,7 @@ class CPU
     void moveMemoryToAccumulator(uint8_t upperBitsAddress, uint8_t lowerBitsAddress);
     void moveAccumulatorToMemory(uint8_t upperbitsAddress, uint8_t lowerBitsAddress);
     void addValueToAccumulator(uint8_t value, uint8_t carry);
+    uint8_t *registerFromIndex(uint8_t index);
     uint8_t registerValueFromOpCode(uint8_t opCode);
     void subtractValueFromAccumulator(uint8_t value);
     void logicalANDWithAccumulator(uint8_t value);
@@ -87,19 +254,20 @@ class CPU
     void rotateAccumulatorRight();
     void rotateAccumulatorLeftWithCarry();
     void rotateAccumulatorRightWithCarry();
-    vector<uint8_t *> * registerPairFromOpCode(uint8_t opCode);
-    void pushRegisterPairOnStack(vector<uint8_t *> * pair);
-    void popStackToRegisterPair(vector<uint8_t *> * pair);
+    uint16_t *registerPairFromOpCode(uint8_t opCode);
+    void pushRegisterPairOnStack(uint16_t *pair);
+    void pushAccumulatorAndStatusPairOnStack();
+    void popStackToRegisterPair(uint16_t *pair);
     void popStackToAccumulatorAndStatusPair();
     void setStatusRegister(uint8_t value);
-    uint16_t valueOfRegisterPair(vector<uint8_t *> * pair);
+    uint16_t valueOfRegisterPair(uint16_t *pair);
     void addValueToRegisterPairH(uint16_t value);
-    void incrementRegisterPair(vector<uint8_t *> * pair);
-    void decrementRegisterPair(vector<uint8_t *> * pair);
-    void exchangeRegisterPairs(vector<uint8_t *> * p1, vector<uint8_t *> * p2);
+    void incrementRegisterPair(uint16_t *pair);
+    void decrementRegisterPair(uint16_t *pair);
+    void exchangeRegisterPairs(uint16_t *p1, uint16_t *p2);
     void exchangeRegistersAndMemory();
     void handle3ByteOp(uint8_t opCode, uint8_t lowBytes, uint8_t highBytes);
-    void replaceRegisterPair(vector<uint8_t *> * pair, uint8_t highBytes, uint8_t lowBytes);
+    void replaceRegisterPair(uint16_t *pair, uint8_t highBytes, uint8_t lowBytes);
     void handle2ByteOp(uint8_t opCode, uint8_t value);
     uint16_t handleJumpByteOp();
     uint16_t handleJump3ByteOp(uint8_t opCode, uint8_t lowBytes, uint8_t highBytes);
@@ -111,6 +279,504 @@ class CPU
     void handleNextInstruction();
     void handleInputFromPort(uint8_t portAddress);
     void handleOutputToPort(uint8_t portAddress);
+    void addWithFlagTables(uint8_t value, uint8_t carry);
+    void subtractWithFlagTables(uint8_t value, uint8_t borrow);
+    void compareWithFlagTables(uint8_t value);
+    void andWithFlagTables(uint8_t value);
+    void xorWithFlagTables(uint8_t value);
+    void orWithFlagTables(uint8_t value);
+    void incrementWithFlagTables(uint8_t *value);
+    void decrementWithFlagTables(uint8_t *value);
+    void decimalAdjustWithFlagTables();
+    void enterPendingInterrupt();
+    void raiseFault(CPUFault fault, uint8_t opCode);
+    void throwFault();
+    void runCore();
+    void dispatchDueEvents();
+    bool continueProgram();
+    static const Instruction instructionTable[256];
+    void executeNextInstruction();
+    bool conditionMet(uint8_t opCode);
+    void skipControlTransfer(uint8_t opCode);
+#ifdef HAS_THREADED_CORE
+    void (CPU::*threadedRunner)();
+    template <class Ports, unsigned Features> void runThreaded();
+    template <unsigned Features> bool continueProgram();
+    template <class Ports> void inputFromPort(uint8_t portAddress);
+    template <class Ports> void outputToPort(uint8_t portAddress);
+#endif
+    void runBlocks();
+    Block *nextBlock(Block *previous);
+    Block *decodeBlock(uint16_t address);
+    bool endsBlock(uint8_t opCode);
+    void executeBlock(Block *block);
+    bool isIdleLoop(const Block *block);
+    void executeIdleLoop(Block *block);
+    void findMemoryLoop(Block *block);
+    uint32_t memoryLoopPasses(const Block *block);
+    void executeMemoryLoop(Block *block);
+    void activateStaticCode();
+    bool runStaticBlock();
+    void executeMicroOp(const MicroOp &op);
+    void removeDeadFlagUpdates(Block *block);
+    InstructionHandler handlerWithoutFlags(uint8_t opCode);
+    void fuseMicroOps(Block *block);
+    bool fuseMicroOpPair(MicroOp *first, const MicroOp &second);
+#ifdef HAS_JIT
+    bool canCompile(Block *block);
+    bool compileBlock(Block *block);
+    bool compileHotBlock(Block *block);
+    void installCompiledBlocks();
+    uint8_t *emitBlock(Block *block, uint8_t *start);
+    static void executeCallOut(CPU *cpu, const MicroOp *op);
+    void emitGuestRegisterLoad(JitEmitter &emitter, int32_t registersOffset, int32_t accumulatorOffset);
+    void emitGuestRegisterStore(JitEmitter &emitter, int32_t registersOffset, int32_t accumulatorOffset);
+    bool emitsNatively(const MicroOp &op);
+    bool emitNativeOp(JitEmitter &emitter, const MicroOp &op);
+#endif
+#ifdef HAS_TRACE_COMPILER
+    bool compileTrace(Block *block);
+    void installTraces();
+    void installTrace(Trace *trace);
+    bool traceIsCurrent(const Trace *trace);
+    bool runTrace(Block *block);
+    static int executeTraceCallOut(void *cpu, unsigned opCode, unsigned operand);
+    string traceStatement(uint8_t opCode, uint16_t operand);
+    string traceSource(uint16_t address, string symbol, vector<uint8_t> *pages);
+#endif
+    void writeMemory(uint16_t address, uint8_t value);
+    uint16_t readWord(uint16_t address);
+    void writeWord(uint16_t address, uint16_t value);
+    void executeAddImmediate(uint8_t opCode, uint16_t operand);
+    void executeAddMemory(uint8_t opCode, uint16_t operand);
+    void executeAddRegister(uint8_t opCode, uint16_t operand);
+    void executeAddRegisterPairToH(uint8_t opCode, uint16_t operand);
+    void executeAddStackPointerToH(uint8_t opCode, uint16_t operand);
+    void executeAddWithCarryImmediate(uint8_t opCode, uint16_t operand);
+    void executeAddWithCarryMemory(uint8_t opCode, uint16_t operand);
+    void executeAddWithCarryRegister(uint8_t opCode, uint16_t operand);
+    void executeAndImmediate(uint8_t opCode, uint16_t operand);
+    void executeAndMemory(uint8_t opCode, uint16_t operand);
+    void executeAndRegister(uint8_t opCode, uint16_t operand);
+    void executeCall(uint8_t opCode, uint16_t operand);
+    void executeCompareImmediate(uint8_t opCode, uint16_t operand);
+    void executeCompareMemory(uint8_t opCode, uint16_t operand);
+    void executeCompareRegister(uint8_t opCode, uint16_t operand);
+    void executeComplementAccumulator(uint8_t opCode, uint16_t operand);
+    void executeComplementCarry(uint8_t opCode, uint16_t operand);
+    void executeConditionalCall(uint8_t opCode, uint16_t operand);
+    void executeConditionalJump(uint8_t opCode, uint16_t operand);
+    void executeConditionalReturn(uint8_t opCode, uint16_t operand);
+    void executeDecimalAdjustAccumulator(uint8_t opCode, uint16_t operand);
+    void executeDecrementMemory(uint8_t opCode, uint16_t operand);
+    void executeDecrementRegister(uint8_t opCode, uint16_t operand);
+    void executeDecrementRegisterPair(uint8_t opCode, uint16_t operand);
+    void executeDecrementStackPointer(uint8_t opCode, uint16_t operand);
+    void executeDisableInterrupts(uint8_t opCode, uint16_t operand);
+    void executeEnableInterrupts(uint8_t opCode, uint16_t operand);
+    void executeExchangeHLWithDE(uint8_t opCode, uint16_t operand);
+    void executeExchangeStackTopWithHL(uint8_t opCode, uint16_t operand);
+    void executeHalt(uint8_t opCode, uint16_t operand);
+    void executeIncrementMemory(uint8_t opCode, uint16_t operand);
+    void executeIncrementRegister(uint8_t opCode, uint16_t operand);
+    void executeIncrementRegisterPair(uint8_t opCode, uint16_t operand);
+    void executeIncrementStackPointer(uint8_t opCode, uint16_t operand);
+    void executeInput(uint8_t opCode, uint16_t operand);
+    void executeJump(uint8_t opCode, uint16_t operand);
+    void executeJumpToHL(uint8_t opCode, uint16_t operand);
+    void executeLoadAccumulatorDirect(uint8_t opCode, uint16_t operand);
+    void executeLoadAccumulatorIndirect(uint8_t opCode, uint16_t operand);
+    void executeLoadHLDirect(uint8_t opCode, uint16_t operand);
+    void executeLoadRegisterPairImmediate(uint8_t opCode, uint16_t operand);
+    void executeLoadStackPointerFromHL(uint8_t opCode, uint16_t operand);
+    void executeLoadStackPointerImmediate(uint8_t opCode, uint16_t operand);
+    void executeMoveImmediate(uint8_t opCode, uint16_t operand);
+    void executeMoveImmediateToMemory(uint8_t opCode, uint16_t operand);
+    void executeMoveMemoryToRegister(uint8_t opCode, uint16_t operand);
+    void executeMoveRegisterToMemory(uint8_t opCode, uint16_t operand);
+    void executeMoveRegisterToRegister(uint8_t opCode, uint16_t operand);
+    void executeNoOperation(uint8_t opCode, uint16_t operand);
+    void executeOrImmediate(uint8_t opCode, uint16_t operand);
+    void executeOrMemory(uint8_t opCode, uint16_t operand);
+    void executeOrRegister(uint8_t opCode, uint16_t operand);
+    void executeOutput(uint8_t opCode, uint16_t operand);
+    void executePopAccumulatorAndStatus(uint8_t opCode, uint16_t operand);
+    void executePushAccumulatorAndStatus(uint8_t opCode, uint16_t operand);
+    void executePopRegisterPair(uint8_t opCode, uint16_t operand);
+    void executePushRegisterPair(uint8_t opCode, uint16_t operand);
+    void executeQuit(uint8_t opCode, uint16_t operand);
+    void executeRestart(uint8_t opCode, uint16_t operand);
+    void executeReturn(uint8_t opCode, uint16_t operand);
+    void executeRotateLeft(uint8_t opCode, uint16_t operand);
+    void executeRotateLeftThroughCarry(uint8_t opCode, uint16_t operand);
+    void executeRotateRight(uint8_t opCode, uint16_t operand);
+    void executeRotateRightThroughCarry(uint8_t opCode, uint16_t operand);
+    void executeSetCarry(uint8_t opCode, uint16_t operand);
+    void executeStoreAccumulatorDirect(uint8_t opCode, uint16_t operand);
+    void executeStoreAccumulatorIndirect(uint8_t opCode, uint16_t operand);
+    void executeStoreHLDirect(uint8_t opCode, uint16_t operand);
+    void executeSubtractImmediate(uint8_t opCode, uint16_t operand);
+    void executeSubtractMemory(uint8_t opCode, uint16_t operand);
+    void executeSubtractRegister(uint8_t opCode, uint16_t operand);
+    void executeSubtractWithBorrowImmediate(uint8_t opCode, uint16_t operand);
+    void executeSubtractWithBorrowMemory(uint8_t opCode, uint16_t operand);
+    void executeSubtractWithBorrowRegister(uint8_t opCode, uint16_t operand);
+    void executeUnhandledOpCode(uint8_t opCode, uint16_t operand);
+    void executeXorImmediate(uint8_t opCode, uint16_t operand);
+    void executeXorMemory(uint8_t opCode, uint16_t operand);
+    void executeXorRegister(uint8_t opCode, uint16_t operand);
+    void executeDecrementRegisterJumpIfNotZero(uint8_t opCode, uint16_t operand);
+    void executeMoveRegisterIncrementRegisterPair(uint8_t opCode, uint16_t operand);
+    void executeMoveMemoryIncrementRegisterPair(uint8_t opCode, uint16_t operand);
+    void executeLoadStoreAccumulatorIndirect(uint8_t opCode, uint16_t operand);
+    void executeMoveImmediateOutput(uint8_t opCode, uint16_t operand);
+    void executeCompareImmediateJumpIfZero(uint8_t opCode, uint16_t operand);
+    void executeCompareImmediateJumpIfNotZero(uint8_t opCode, uint16_t operand);
+    void executeIncrementRegisterWithoutFlags(uint8_t opCode, uint16_t operand);
+    void executeDecrementRegisterWithoutFlags(uint8_t opCode, uint16_t operand);
+    void executeArithmeticWithoutFlags(uint8_t opCode, uint16_t operand);
+    void executeAddRegisterPairToHWithoutFlags(uint8_t opCode, uint16_t operand);
 };
 
+inline uint8_t CPU::registerM()
+{
+  return memory[currentMemoryAddress()];
+}
+
+inline uint16_t CPU::currentMemoryAddress()
+{
+  return registerPairs[REGISTER_PAIR_H];
+}
+
+inline uint8_t *CPU::registerFromIndex(uint8_t index)
+{
+  return &registers[index ^ REGISTER_INDEX_SWAP];
+}
+
+inline uint8_t CPU::registerValueFromOpCode(uint8_t opCode)
+{
+  return *registerFromIndex(opCode & 7);
+}
+
+inline uint16_t *CPU::registerPairFromOpCode(uint8_t opCode)
+{
+  return &registerPairs[(opCode >> 4) & 0x3];
+}
+
+/*
+ * Binds the threaded core to a concrete port handler type, so its IN and
+ * OUT calls are direct and can be inlined, and compiles out the checks for
+ * any feature not in Features. Each combination used must be instantiated
+ * in threaded_core.cpp. Other cores use the handler as a PortHandler.
+ */
+template <class Ports, unsigned Features> inline void CPU::setPortHandler(Ports *handler)
+{
+  portHandler = handler;
+#ifdef HAS_THREADED_CORE
+  threadedRunner = &CPU::runThreaded<Ports, Features>;
+#endif
+}
+
+#ifdef HAS_THREADED_CORE
+template <unsigned Features> inline bool CPU::continueProgram()
+{
+  if (cycles >= cycleLimit)
+  {
+    return false;
+  }
+
+  if ((Features & CORE_FEATURE_TEST_HOOKS) && (programCounter >= programLength || !runProgram))
+  {
+    return false;
+  }
+
+  return !(Features & CORE_FEATURE_STEPPING) || !stopAfterInstruction;
+}
+
+template <class Ports> inline void CPU::inputFromPort(uint8_t portAddress)
+{
+  registerA = static_cast<Ports *>(portHandler)->Ports::inputPortHandler(portAddress);
+}
+
+template <class Ports> inline void CPU::outputToPort(uint8_t portAddress)
+{
+  static_cast<Ports *>(portHandler)->Ports::outputPortHandler(portAddress, registerA);
+}
+
+// The type-erased core checks for a missing handler and calls it virtually.
+template <> inline void CPU::inputFromPort<PortHandler>(uint8_t portAddress)
+{
+  handleInputFromPort(portAddress);
+}
+
+template <> inline void CPU::outputToPort<PortHandler>(uint8_t portAddress)
+{
+  handleOutputToPort(portAddress);
+}
+#endif
+
+inline void CPU::executeMicroOp(const MicroOp &op)
+{
+  programCounter += op.length;
+  cycles += op.cycles;
+  (this->*op.handler)(op.opCode, op.operand);
+}
+
+inline void CPU::writeMemory(uint16_t address, uint8_t value)
+{
+  memory[address] = value;
+  blockCache.recordWrite(address >> 8);
+}
+
+/*
+ * Little-endian words, read and written as one unaligned 16-bit access. A
+ * word at 0xffff wraps round to address 0, as it does on the 8080, and is
+ * accessed a byte at a time.
+ */
+inline uint16_t CPU::readWord(uint16_t address)
+{
+  uint16_t value;
+
+  if (address == 0xffff)
+  {
+    return memory[0] << 8 | memory[0xffff];
+  }
+
+  memcpy(&value, memory.data() + address, 2);
+#ifdef REGISTER_FILE_BIG_ENDIAN
+  value = value << 8 | value >> 8;
+#endif
+  return value;
+}
+
+inline void CPU::writeWord(uint16_t address, uint16_t value)
+{
+  if (address == 0xffff)
+  {
+    writeMemory(0xffff, value & 0xff);
+    writeMemory(0, value >> 8);
+    return;
+  }
+
+#ifdef REGISTER_FILE_BIG_ENDIAN
+  value = value << 8 | value >> 8;
+#endif
+  memcpy(memory.data() + address, &value, 2);
+  blockCache.recordWrite(address >> 8);
+
+  if ((address & 0xff) == 0xff)
+  {
+    blockCache.recordWrite((address >> 8) + 1);
+  }
+}
+
+inline bool CPU::carryBitSet()
+{
+  materializeFlags();
+  return status & CARRY_BIT;
+}
+
+inline bool CPU::parityBitSet()
+{
+  materializeFlags();
+  return status & PARITY_BIT;
+}
+
+inline bool CPU::signBitSet()
+{
+  materializeFlags();
+  return status & SIGN_BIT;
+}
+
+inline bool CPU::zeroBitSet()
+{
+  materializeFlags();
+  return status & ZERO_BIT;
+}
+
+inline bool CPU::auxiliaryCarryBitSet()
+{
+  materializeFlags();
+  return status & AUXILIARY_CARRY_BIT;
+}
+
+inline uint8_t CPU::statusRegister()
+{
+  materializeFlags();
+  return status;
+}
+
+inline bool CPU::conditionMet(uint8_t opCode)
+{
+  static const uint8_t conditionBits[4] = { ZERO_BIT, CARRY_BIT, PARITY_BIT, SIGN_BIT };
+  uint8_t condition = opCode >> 3 & 7;
+
+  materializeFlags();
+  return ((status & conditionBits[condition >> 1]) != 0) == (condition & 1);
+}
+
+// With followJumps off the switch core steps over a jump, call or return
+// without charging its cycles. The other cores charge them before the
+// handler runs, so the handler gives them back.
+inline void CPU::skipControlTransfer(uint8_t opCode)
+{
+  cycles -= instructionTable[opCode].cycles;
+}
+
+// The operations whose flags deferFlags() can record.
+#define DEFERRED_ADD 0
+#define DEFERRED_SUBTRACT 1
+#define DEFERRED_LOGICAL 2
+#define DEFERRED_INCREMENT 3
+#define DEFERRED_DECREMENT 4
+
+/*
+ * In lazy flag mode the ALU helpers record their operands instead of
+ * updating the status register. The flags are only worked out when
+ * something reads them, or when a later operation leaves some of the
+ * deferred bits in place.
+ */
+inline void CPU::deferFlags(uint8_t operation, uint8_t mask, uint8_t operand, uint8_t value, uint8_t carry)
+{
+  if (deferredFlagMask & ~mask)
+  {
+    resolveDeferredFlags();
+  }
+
+  deferredFlagOperation = operation;
+  deferredFlagMask = mask;
+  deferredFlagOperand = operand;
+  deferredFlagValue = value;
+  deferredFlagCarry = carry;
+}
+
+inline void CPU::materializeFlags()
+{
+  if (deferredFlagMask)
+  {
+    resolveDeferredFlags();
+  }
+}
+
+/*
+ * The table and threaded cores update the status register from the flag
+ * tables. The switch core keeps the original helpers as the reference.
+ */
+inline void CPU::addWithFlagTables(uint8_t value, uint8_t carry)
+{
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_ADD, ALU_FLAG_BITS, registerA, value, carry);
+    registerA += value + carry;
+    return;
+  }
+
+  uint16_t entry = addFlagTable[carry][registerA][value];
+
+  registerA = FLAG_TABLE_RESULT(entry);
+  status = (status & ~ALU_FLAG_BITS) | FLAG_TABLE_FLAGS(entry);
+}
+
+inline void CPU::subtractWithFlagTables(uint8_t value, uint8_t borrow)
+{
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_SUBTRACT, ALU_FLAG_BITS, registerA, value, borrow);
+    registerA -= (uint8_t)(value + borrow);
+    return;
+  }
+
+  uint16_t entry = subtractFlagTable[borrow][registerA][value];
+
+  registerA = FLAG_TABLE_RESULT(entry);
+  status = (status & ~ALU_FLAG_BITS) | FLAG_TABLE_FLAGS(entry);
+}
+
+inline void CPU::compareWithFlagTables(uint8_t value)
+{
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_SUBTRACT, ALU_FLAG_BITS, registerA, value, 0);
+    return;
+  }
+
+  status = (status & ~ALU_FLAG_BITS) | FLAG_TABLE_FLAGS(subtractFlagTable[0][registerA][value]);
+}
+
+inline void CPU::andWithFlagTables(uint8_t value)
+{
+  registerA &= value;
+
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_LOGICAL, SZP_BITS | CARRY_BIT, registerA, 0, 0);
+    return;
+  }
+
+  status = (status & ~(SZP_BITS | CARRY_BIT)) | szpFlagTable[registerA];
+}
+
+inline void CPU::xorWithFlagTables(uint8_t value)
+{
+  registerA ^= value;
+
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_LOGICAL, SZP_BITS | CARRY_BIT, registerA, 0, 0);
+    return;
+  }
+
+  status = (status & ~(SZP_BITS | CARRY_BIT)) | szpFlagTable[registerA];
+}
+
+inline void CPU::orWithFlagTables(uint8_t value)
+{
+  registerA |= value;
+
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_LOGICAL, SZP_BITS | CARRY_BIT, registerA, 0, 0);
+    return;
+  }
+
+  status = (status & ~(SZP_BITS | CARRY_BIT)) | szpFlagTable[registerA];
+}
+
+inline void CPU::incrementWithFlagTables(uint8_t *value)
+{
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_INCREMENT, SZP_BITS | AUXILIARY_CARRY_BIT, *value, 0, 0);
+    (*value)++;
+    return;
+  }
+
+  uint16_t entry = addFlagTable[0][*value][1];
+
+  *value = FLAG_TABLE_RESULT(entry);
+  status = (status & ~(SZP_BITS | AUXILIARY_CARRY_BIT)) | (FLAG_TABLE_FLAGS(entry) & (SZP_BITS | AUXILIARY_CARRY_BIT));
+}
+
+inline void CPU::decrementWithFlagTables(uint8_t *value)
+{
+  (*value)--;
+
+  if (lazyFlags)
+  {
+    deferFlags(DEFERRED_DECREMENT, SZP_BITS, *value, 0, 0);
+    return;
+  }
+
+  status = (status & ~SZP_BITS) | szpFlagTable[*value];
+}
+
+inline void CPU::decimalAdjustWithFlagTables()
+{
+  materializeFlags();
+  uint16_t entry = decimalAdjustFlagTable[(status & AUXILIARY_CARRY_BIT) ? 1 : 0][status & CARRY_BIT][registerA];
+
+  registerA = FLAG_TABLE_RESULT(entry);
+  status = (status & ~(AUXILIARY_CARRY_BIT | CARRY_BIT)) | FLAG_TABLE_FLAGS(entry);
+}
+
 #endif
@@ -0,0 +1,20 @@
+#ifndef EVENT_HANDLER_H
+#define EVENT_HANDLER_H
+
+#include <cstdint>
+
+class CPU;
+
+/*
+ * A device that wants to run at a given cycle. The handler is called between
+ * instructions once the CPU's cycle counter has reached the scheduled cycle,
+ * which is passed back so repeating events can be scheduled without drift.
+ */
+class EventHandler
+{
+  public:
+    virtual ~EventHandler() {}
+    virtual void handleEvent(CPU *cpu, uint8_t event, uint64_t cycle) = 0;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "bit_ops.h"
+#include "flag_tables.h"
+#include "status_bits.h"
+
+uint8_t szpFlagTable[256];
+uint16_t addFlagTable[2][256][256];
+uint16_t subtractFlagTable[2][256][256];
+uint16_t decimalAdjustFlagTable[2][2][256];
+
+void initFlagTables()
+{
+  static bool initialised = false;
+
+  if (initialised)
+  {
+    return;
+  }
+
+  for (int a = 0; a < 256; a++)
+  {
+    szpFlagTable[a] = computeSZPFlags(a);
+
+    for (int carry = 0; carry < 2; carry++)
+    {
+      for (int value = 0; value < 256; value++)
+      {
+        addFlagTable[carry][a][value] = computeAddFlags(a, value, carry);
+        subtractFlagTable[carry][a][value] = computeSubtractFlags(a, value, carry);
+      }
+
+      for (int auxiliaryCarry = 0; auxiliaryCarry < 2; auxiliaryCarry++)
+      {
+        decimalAdjustFlagTable[auxiliaryCarry][carry][a] = computeDecimalAdjustFlags(a, auxiliaryCarry, carry);
+      }
+    }
+  }
+
+  initialised = true;
+}
+
+uint8_t computeSZPFlags(uint8_t result)
+{
+  uint8_t flags = 0;
+  uint8_t parity = (result ^ result >> 4) & 0xf;
+
+  if ((0x9669 >> parity) & 1)
+  {
+    flags |= PARITY_BIT;
+  }
+
+  if (result == 0)
+  {
+    flags |= ZERO_BIT;
+  }
+
+  if ((int8_t)result < 0)
+  {
+    flags |= SIGN_BIT;
+  }
+
+  return flags;
+}
+
+uint16_t computeAddFlags(uint8_t accumulator, uint8_t value, uint8_t carry)
+{
+  uint8_t flags = 0;
+  uint8_t result = accumulator + value;
+
+  if (hasCarryAtBitIndex(accumulator, value, AUXILIARY_CARRY_SHIFT))
+  {
+    flags |= AUXILIARY_CARRY_BIT;
+  }
+
+  if (hasCarryAtBitIndex(accumulator, value, CARRY_SHIFT))
+  {
+    flags |= CARRY_BIT;
+  }
+
+  // The carry is added as a second addition, which sets the flags again
+  if (carry)
+  {
+    return computeAddFlags(result, 1, 0);
+  }
+
+  return result | (flags | computeSZPFlags(result)) << 8;
+}
+
+uint16_t computeSubtractFlags(uint8_t accumulator, uint8_t value, uint8_t borrow)
+{
+  uint8_t flags = 0;
+  uint8_t twosComplement = ~(uint8_t)(value + borrow) + 1;
+  uint8_t result = accumulator + twosComplement;
+
+  if (!hasCarryAtBitIndex(accumulator, twosComplement, CARRY_SHIFT))
+  {
+    flags |= CARRY_BIT;
+  }
+
+  if (hasCarryAtBitIndex(accumulator, twosComplement, AUXILIARY_CARRY_SHIFT))
+  {
+    flags |= AUXILIARY_CARRY_BIT;
+  }
+
+  return result | (flags | computeSZPFlags(result)) << 8;
+}
+
+uint16_t computeDecimalAdjustFlags(uint8_t accumulator, bool auxiliaryCarry, bool carry)
+{
+  uint8_t operand = 6;
+
+  if (getLowerNibble(accumulator) > 9 || auxiliaryCarry)
+  {
+    auxiliaryCarry = hasCarryAtBitIndex(accumulator, operand, AUXILIARY_CARRY_SHIFT);
+    accumulator += operand;
+  }
+
+  uint8_t upperBits = getUpperNibble(accumulator);
+  if (upperBits > 9 || carry)
+  {
+    carry = hasCarryAtBitIndex(upperBits, operand, AUXILIARY_CARRY_SHIFT);
+    upperBits += operand;
+  }
+
+  accumulator &= 0x0F;
+  accumulator |= upperBits << 4;
+
+  return accumulator | ((auxiliaryCarry ? AUXILIARY_CARRY_BIT : 0) | (carry ? CARRY_BIT : 0)) << 8;
+}
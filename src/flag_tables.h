@@ -0,0 +1,28 @@
+#ifndef FLAG_TABLES_H
+#define FLAG_TABLES_H
+
+#include <cstdint>
+
+/*
+ * Precomputed results and status flags for the 8-bit ALU operations. Each
+ * 16-bit entry holds the result in its low byte and the S, Z, AC, P and CY
+ * bits in its high byte. The tables are built from the same arithmetic as
+ * the switch core's helpers, so both produce identical status registers.
+ */
+
+#define FLAG_TABLE_RESULT(entry) ((uint8_t)((entry) & 0xff))
+#define FLAG_TABLE_FLAGS(entry) ((uint8_t)((entry) >> 8))
+
+extern uint8_t szpFlagTable[256];
+extern uint16_t addFlagTable[2][256][256];
+extern uint16_t subtractFlagTable[2][256][256];
+extern uint16_t decimalAdjustFlagTable[2][2][256];
+
+void initFlagTables();
+
+uint8_t computeSZPFlags(uint8_t result);
+uint16_t computeAddFlags(uint8_t accumulator, uint8_t value, uint8_t carry);
+uint16_t computeSubtractFlags(uint8_t accumulator, uint8_t value, uint8_t borrow);
+uint16_t computeDecimalAdjustFlags(uint8_t accumulator, bool auxiliaryCarry, bool carry);
+
+#endif
@@ -0,0 +1,874 @@
+#include "bit_ops.h"
+#include "cpu.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+#include "status_bits.h"
+
+/*
+ * Lengths and cycles come from the op code metadata, so the table only
+ * chooses a handler for each op code.
+ */
+#define INSTRUCTION(opCode, handler) { handler, interpreterLength(opCode), interpreterCycles(opCode) }
+
+const Instruction CPU::instructionTable[256] = {
+  INSTRUCTION(NOP, &CPU::executeNoOperation),
+  INSTRUCTION(LXI_B, &CPU::executeLoadRegisterPairImmediate),
+  INSTRUCTION(STAX_B, &CPU::executeStoreAccumulatorIndirect),
+  INSTRUCTION(INX_B, &CPU::executeIncrementRegisterPair),
+  INSTRUCTION(INR_B, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_B, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_B, &CPU::executeMoveImmediate),
+  INSTRUCTION(RLC, &CPU::executeRotateLeft),
+  INSTRUCTION(QUIT, &CPU::executeQuit),
+  INSTRUCTION(DAD_B, &CPU::executeAddRegisterPairToH),
+  INSTRUCTION(LDX_B, &CPU::executeLoadAccumulatorIndirect),
+  INSTRUCTION(DCX_B, &CPU::executeDecrementRegisterPair),
+  INSTRUCTION(INR_C, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_C, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_C, &CPU::executeMoveImmediate),
+  INSTRUCTION(RRC, &CPU::executeRotateRight),
+  INSTRUCTION(0x10, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(LXI_D, &CPU::executeLoadRegisterPairImmediate),
+  INSTRUCTION(STAX_D, &CPU::executeStoreAccumulatorIndirect),
+  INSTRUCTION(INX_D, &CPU::executeIncrementRegisterPair),
+  INSTRUCTION(INR_D, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_D, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_D, &CPU::executeMoveImmediate),
+  INSTRUCTION(RAL, &CPU::executeRotateLeftThroughCarry),
+  INSTRUCTION(0x18, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(DAD_D, &CPU::executeAddRegisterPairToH),
+  INSTRUCTION(LDX_D, &CPU::executeLoadAccumulatorIndirect),
+  INSTRUCTION(DCX_D, &CPU::executeDecrementRegisterPair),
+  INSTRUCTION(INR_E, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_E, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_E, &CPU::executeMoveImmediate),
+  INSTRUCTION(RAR, &CPU::executeRotateRightThroughCarry),
+  INSTRUCTION(0x20, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(LXI_H, &CPU::executeLoadRegisterPairImmediate),
+  INSTRUCTION(SHLD, &CPU::executeStoreHLDirect),
+  INSTRUCTION(INX_H, &CPU::executeIncrementRegisterPair),
+  INSTRUCTION(INR_H, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_H, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_H, &CPU::executeMoveImmediate),
+  INSTRUCTION(DAA, &CPU::executeDecimalAdjustAccumulator),
+  INSTRUCTION(0x28, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(DAD_H, &CPU::executeAddRegisterPairToH),
+  INSTRUCTION(LXLD, &CPU::executeLoadHLDirect),
+  INSTRUCTION(DCX_H, &CPU::executeDecrementRegisterPair),
+  INSTRUCTION(INR_L, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_L, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_L, &CPU::executeMoveImmediate),
+  INSTRUCTION(CMA, &CPU::executeComplementAccumulator),
+  INSTRUCTION(0x30, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(LXI_SP, &CPU::executeLoadStackPointerImmediate),
+  INSTRUCTION(STA, &CPU::executeStoreAccumulatorDirect),
+  INSTRUCTION(INX_SP, &CPU::executeIncrementStackPointer),
+  INSTRUCTION(INR_M, &CPU::executeIncrementMemory),
+  INSTRUCTION(DCR_M, &CPU::executeDecrementMemory),
+  INSTRUCTION(MVI_M, &CPU::executeMoveImmediateToMemory),
+  INSTRUCTION(STC, &CPU::executeSetCarry),
+  INSTRUCTION(0x38, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(DAD_SP, &CPU::executeAddStackPointerToH),
+  INSTRUCTION(LDA, &CPU::executeLoadAccumulatorDirect),
+  INSTRUCTION(DCX_SP, &CPU::executeDecrementStackPointer),
+  INSTRUCTION(INR_A, &CPU::executeIncrementRegister),
+  INSTRUCTION(DCR_A, &CPU::executeDecrementRegister),
+  INSTRUCTION(MVI_A, &CPU::executeMoveImmediate),
+  INSTRUCTION(CMC, &CPU::executeComplementCarry),
+  INSTRUCTION(MOV_B_B, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_B_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_B_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_B_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_B_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_B_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_B_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_B_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_C, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_C_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_C_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_C_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_D, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_D_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_D_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_D_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_E, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_E_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_E_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_E_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_H, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_H_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_H_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_H_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_L_L, &CPU::executeNoOperation),
+  INSTRUCTION(MOV_L_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_L_A, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_M_B, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_M_C, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_M_D, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_M_E, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_M_H, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_M_L, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(HLT, &CPU::executeHalt),
+  INSTRUCTION(MOV_M_A, &CPU::executeMoveRegisterToMemory),
+  INSTRUCTION(MOV_A_B, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_C, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_D, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_E, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_H, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_L, &CPU::executeMoveRegisterToRegister),
+  INSTRUCTION(MOV_A_M, &CPU::executeMoveMemoryToRegister),
+  INSTRUCTION(MOV_A_A, &CPU::executeNoOperation),
+  INSTRUCTION(ADD_B, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_C, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_D, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_E, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_H, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_L, &CPU::executeAddRegister),
+  INSTRUCTION(ADD_M, &CPU::executeAddMemory),
+  INSTRUCTION(ADD_A, &CPU::executeAddRegister),
+  INSTRUCTION(ADC_B, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_C, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_D, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_E, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_H, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_L, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(ADC_M, &CPU::executeAddWithCarryMemory),
+  INSTRUCTION(ADC_A, &CPU::executeAddWithCarryRegister),
+  INSTRUCTION(SUB_B, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_C, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_D, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_E, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_H, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_L, &CPU::executeSubtractRegister),
+  INSTRUCTION(SUB_M, &CPU::executeSubtractMemory),
+  INSTRUCTION(SUB_A, &CPU::executeSubtractRegister),
+  INSTRUCTION(SBB_B, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_C, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_D, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_E, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_H, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_L, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(SBB_M, &CPU::executeSubtractWithBorrowMemory),
+  INSTRUCTION(SBB_A, &CPU::executeSubtractWithBorrowRegister),
+  INSTRUCTION(ANA_B, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_C, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_D, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_E, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_H, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_L, &CPU::executeAndRegister),
+  INSTRUCTION(ANA_M, &CPU::executeAndMemory),
+  INSTRUCTION(ANA_A, &CPU::executeAndRegister),
+  INSTRUCTION(XRA_B, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_C, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_D, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_E, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_H, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_L, &CPU::executeXorRegister),
+  INSTRUCTION(XRA_M, &CPU::executeXorMemory),
+  INSTRUCTION(XRA_A, &CPU::executeXorRegister),
+  INSTRUCTION(ORA_B, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_C, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_D, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_E, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_H, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_L, &CPU::executeOrRegister),
+  INSTRUCTION(ORA_M, &CPU::executeOrMemory),
+  INSTRUCTION(ORA_A, &CPU::executeOrRegister),
+  INSTRUCTION(CMP_B, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_C, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_D, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_E, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_H, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_L, &CPU::executeCompareRegister),
+  INSTRUCTION(CMP_M, &CPU::executeCompareMemory),
+  INSTRUCTION(CMP_A, &CPU::executeCompareRegister),
+  INSTRUCTION(RNZ, &CPU::executeConditionalReturn),
+  INSTRUCTION(POP_B, &CPU::executePopRegisterPair),
+  INSTRUCTION(JNZ, &CPU::executeConditionalJump),
+  INSTRUCTION(JMP, &CPU::executeJump),
+  INSTRUCTION(CNZ, &CPU::executeConditionalCall),
+  INSTRUCTION(PUSH_B, &CPU::executePushRegisterPair),
+  INSTRUCTION(ADI, &CPU::executeAddImmediate),
+  INSTRUCTION(RST_0, &CPU::executeRestart),
+  INSTRUCTION(RZ, &CPU::executeConditionalReturn),
+  INSTRUCTION(RET, &CPU::executeReturn),
+  INSTRUCTION(JZ, &CPU::executeConditionalJump),
+  INSTRUCTION(0xcb, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(CZ, &CPU::executeConditionalCall),
+  INSTRUCTION(CALL, &CPU::executeCall),
+  INSTRUCTION(ACI, &CPU::executeAddWithCarryImmediate),
+  INSTRUCTION(RST_1, &CPU::executeRestart),
+  INSTRUCTION(RNC, &CPU::executeConditionalReturn),
+  INSTRUCTION(POP_D, &CPU::executePopRegisterPair),
+  INSTRUCTION(JNC, &CPU::executeConditionalJump),
+  INSTRUCTION(OUT, &CPU::executeOutput),
+  INSTRUCTION(CNC, &CPU::executeConditionalCall),
+  INSTRUCTION(PUSH_D, &CPU::executePushRegisterPair),
+  INSTRUCTION(SUI, &CPU::executeSubtractImmediate),
+  INSTRUCTION(RST_2, &CPU::executeRestart),
+  INSTRUCTION(RC, &CPU::executeConditionalReturn),
+  INSTRUCTION(0xd9, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(JC, &CPU::executeConditionalJump),
+  INSTRUCTION(IN, &CPU::executeInput),
+  INSTRUCTION(CC, &CPU::executeConditionalCall),
+  INSTRUCTION(0xdd, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(SBI, &CPU::executeSubtractWithBorrowImmediate),
+  INSTRUCTION(RST_3, &CPU::executeRestart),
+  INSTRUCTION(RPO, &CPU::executeConditionalReturn),
+  INSTRUCTION(POP_H, &CPU::executePopRegisterPair),
+  INSTRUCTION(JPO, &CPU::executeConditionalJump),
+  INSTRUCTION(XTHL, &CPU::executeExchangeStackTopWithHL),
+  INSTRUCTION(CPO, &CPU::executeConditionalCall),
+  INSTRUCTION(PUSH_H, &CPU::executePushRegisterPair),
+  INSTRUCTION(ANI, &CPU::executeAndImmediate),
+  INSTRUCTION(RST_4, &CPU::executeRestart),
+  INSTRUCTION(RPE, &CPU::executeConditionalReturn),
+  INSTRUCTION(PCHL, &CPU::executeJumpToHL),
+  INSTRUCTION(JPE, &CPU::executeConditionalJump),
+  INSTRUCTION(XCHG, &CPU::executeExchangeHLWithDE),
+  INSTRUCTION(CPE, &CPU::executeConditionalCall),
+  INSTRUCTION(0xed, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(XRI, &CPU::executeXorImmediate),
+  INSTRUCTION(RST_5, &CPU::executeRestart),
+  INSTRUCTION(RP, &CPU::executeConditionalReturn),
+  INSTRUCTION(POP_PSW, &CPU::executePopAccumulatorAndStatus),
+  INSTRUCTION(JP, &CPU::executeConditionalJump),
+  INSTRUCTION(DI, &CPU::executeDisableInterrupts),
+  INSTRUCTION(CP, &CPU::executeConditionalCall),
+  INSTRUCTION(PUSH_PSW, &CPU::executePushAccumulatorAndStatus),
+  INSTRUCTION(ORI, &CPU::executeOrImmediate),
+  INSTRUCTION(RST_6, &CPU::executeRestart),
+  INSTRUCTION(RM, &CPU::executeConditionalReturn),
+  INSTRUCTION(SPHL, &CPU::executeLoadStackPointerFromHL),
+  INSTRUCTION(JM, &CPU::executeConditionalJump),
+  INSTRUCTION(EI, &CPU::executeEnableInterrupts),
+  INSTRUCTION(CM, &CPU::executeConditionalCall),
+  INSTRUCTION(0xfd, &CPU::executeUnhandledOpCode),
+  INSTRUCTION(CPI, &CPU::executeCompareImmediate),
+  INSTRUCTION(RST_7, &CPU::executeRestart)
+};
+
+void CPU::executeNextInstruction()
+{
+  if (halt)
+  {
+    return;
+  }
+
+  enterPendingInterrupt();
+
+  uint8_t opCode = memory[programCounter];
+  const Instruction &instruction = instructionTable[opCode];
+  uint16_t operand = memory[(uint16_t)(programCounter + 2)] << 8 | memory[(uint16_t)(programCounter + 1)];
+
+  programCounter += instruction.length;
+  cycles += instruction.cycles;
+  (this->*instruction.handler)(opCode, operand);
+}
+
+void CPU::executeNoOperation(uint8_t opCode, uint16_t operand)
+{
+}
+
+// Undefined op codes are traps, dispatched with the program counter still
+// on them.
+void CPU::executeUnhandledOpCode(uint8_t opCode, uint16_t operand)
+{
+  raiseFault(UNHANDLED_OP_CODE_FAULT, opCode);
+  programCounter++;
+}
+
+void CPU::executeQuit(uint8_t opCode, uint16_t operand)
+{
+  runProgram = false;
+}
+
+void CPU::executeHalt(uint8_t opCode, uint16_t operand)
+{
+  halt = true;
+}
+
+void CPU::executeLoadRegisterPairImmediate(uint8_t opCode, uint16_t operand)
+{
+  replaceRegisterPair(registerPairFromOpCode(opCode), operand >> 8, operand & 0xff);
+}
+
+void CPU::executeLoadStackPointerImmediate(uint8_t opCode, uint16_t operand)
+{
+  stackPointer = operand;
+}
+
+void CPU::executeStoreAccumulatorIndirect(uint8_t opCode, uint16_t operand)
+{
+  writeMemory(*registerPairFromOpCode(opCode), registerA);
+}
+
+void CPU::executeLoadAccumulatorIndirect(uint8_t opCode, uint16_t operand)
+{
+  registerA = memory[*registerPairFromOpCode(opCode)];
+}
+
+void CPU::executeStoreAccumulatorDirect(uint8_t opCode, uint16_t operand)
+{
+  writeMemory(operand, registerA);
+}
+
+void CPU::executeLoadAccumulatorDirect(uint8_t opCode, uint16_t operand)
+{
+  registerA = memory[operand];
+}
+
+void CPU::executeStoreHLDirect(uint8_t opCode, uint16_t operand)
+{
+  writeWord(operand, registerPairs[REGISTER_PAIR_H]);
+}
+
+void CPU::executeLoadHLDirect(uint8_t opCode, uint16_t operand)
+{
+  registerPairs[REGISTER_PAIR_H] = readWord(operand);
+}
+
+void CPU::executeIncrementRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  incrementRegisterPair(registerPairFromOpCode(opCode));
+}
+
+void CPU::executeDecrementRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  decrementRegisterPair(registerPairFromOpCode(opCode));
+}
+
+void CPU::executeIncrementStackPointer(uint8_t opCode, uint16_t operand)
+{
+  stackPointer++;
+}
+
+void CPU::executeDecrementStackPointer(uint8_t opCode, uint16_t operand)
+{
+  stackPointer--;
+}
+
+void CPU::executeIncrementRegister(uint8_t opCode, uint16_t operand)
+{
+  incrementWithFlagTables(registerFromIndex(opCode >> 3 & 7));
+}
+
+void CPU::executeDecrementRegister(uint8_t opCode, uint16_t operand)
+{
+  decrementWithFlagTables(registerFromIndex(opCode >> 3 & 7));
+}
+
+void CPU::executeIncrementMemory(uint8_t opCode, uint16_t operand)
+{
+  uint8_t value = registerM();
+
+  incrementWithFlagTables(&value);
+  writeMemory(currentMemoryAddress(), value);
+}
+
+void CPU::executeDecrementMemory(uint8_t opCode, uint16_t operand)
+{
+  uint8_t value = registerM();
+
+  decrementWithFlagTables(&value);
+  writeMemory(currentMemoryAddress(), value);
+}
+
+void CPU::executeMoveImmediate(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = operand & 0xff;
+}
+
+void CPU::executeMoveImmediateToMemory(uint8_t opCode, uint16_t operand)
+{
+  writeMemory(currentMemoryAddress(), operand & 0xff);
+}
+
+void CPU::executeMoveRegisterToRegister(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = *registerFromIndex(opCode & 7);
+}
+
+void CPU::executeMoveRegisterToMemory(uint8_t opCode, uint16_t operand)
+{
+  writeMemory(currentMemoryAddress(), *registerFromIndex(opCode & 7));
+}
+
+void CPU::executeMoveMemoryToRegister(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = registerM();
+}
+
+void CPU::executeRotateLeft(uint8_t opCode, uint16_t operand)
+{
+  rotateAccumulatorLeft();
+}
+
+void CPU::executeRotateRight(uint8_t opCode, uint16_t operand)
+{
+  rotateAccumulatorRight();
+}
+
+void CPU::executeRotateLeftThroughCarry(uint8_t opCode, uint16_t operand)
+{
+  rotateAccumulatorLeftWithCarry();
+}
+
+void CPU::executeRotateRightThroughCarry(uint8_t opCode, uint16_t operand)
+{
+  rotateAccumulatorRightWithCarry();
+}
+
+void CPU::executeAddRegisterPairToH(uint8_t opCode, uint16_t operand)
+{
+  addValueToRegisterPairH(valueOfRegisterPair(registerPairFromOpCode(opCode)));
+}
+
+void CPU::executeAddStackPointerToH(uint8_t opCode, uint16_t operand)
+{
+  addValueToRegisterPairH(stackPointer);
+}
+
+void CPU::executeDecimalAdjustAccumulator(uint8_t opCode, uint16_t operand)
+{
+  decimalAdjustWithFlagTables();
+}
+
+void CPU::executeComplementAccumulator(uint8_t opCode, uint16_t operand)
+{
+  complimentAccumulator();
+}
+
+void CPU::executeSetCarry(uint8_t opCode, uint16_t operand)
+{
+  setStatus(CARRY_BIT);
+}
+
+void CPU::executeComplementCarry(uint8_t opCode, uint16_t operand)
+{
+  flipStatusBit(CARRY_BIT);
+}
+
+void CPU::executeAddRegister(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(registerValueFromOpCode(opCode), 0);
+}
+
+void CPU::executeAddMemory(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(registerM(), 0);
+}
+
+void CPU::executeAddImmediate(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(operand & 0xff, 0);
+}
+
+void CPU::executeAddWithCarryRegister(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(registerValueFromOpCode(opCode), carryBitSet());
+}
+
+void CPU::executeAddWithCarryMemory(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(registerM(), carryBitSet());
+}
+
+void CPU::executeAddWithCarryImmediate(uint8_t opCode, uint16_t operand)
+{
+  addWithFlagTables(operand & 0xff, carryBitSet());
+}
+
+void CPU::executeSubtractRegister(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(registerValueFromOpCode(opCode), 0);
+}
+
+void CPU::executeSubtractMemory(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(registerM(), 0);
+}
+
+void CPU::executeSubtractImmediate(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(operand & 0xff, 0);
+}
+
+void CPU::executeSubtractWithBorrowRegister(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(registerValueFromOpCode(opCode), carryBitSet());
+}
+
+void CPU::executeSubtractWithBorrowMemory(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(registerM(), carryBitSet());
+}
+
+void CPU::executeSubtractWithBorrowImmediate(uint8_t opCode, uint16_t operand)
+{
+  subtractWithFlagTables(operand & 0xff, carryBitSet());
+}
+
+void CPU::executeAndRegister(uint8_t opCode, uint16_t operand)
+{
+  andWithFlagTables(registerValueFromOpCode(opCode));
+}
+
+void CPU::executeAndMemory(uint8_t opCode, uint16_t operand)
+{
+  andWithFlagTables(registerM());
+}
+
+void CPU::executeAndImmediate(uint8_t opCode, uint16_t operand)
+{
+  andWithFlagTables(operand & 0xff);
+}
+
+void CPU::executeXorRegister(uint8_t opCode, uint16_t operand)
+{
+  xorWithFlagTables(registerValueFromOpCode(opCode));
+}
+
+void CPU::executeXorMemory(uint8_t opCode, uint16_t operand)
+{
+  xorWithFlagTables(registerM());
+}
+
+void CPU::executeXorImmediate(uint8_t opCode, uint16_t operand)
+{
+  xorWithFlagTables(operand & 0xff);
+}
+
+void CPU::executeOrRegister(uint8_t opCode, uint16_t operand)
+{
+  orWithFlagTables(registerValueFromOpCode(opCode));
+}
+
+void CPU::executeOrMemory(uint8_t opCode, uint16_t operand)
+{
+  orWithFlagTables(registerM());
+}
+
+void CPU::executeOrImmediate(uint8_t opCode, uint16_t operand)
+{
+  orWithFlagTables(operand & 0xff);
+}
+
+void CPU::executeCompareRegister(uint8_t opCode, uint16_t operand)
+{
+  compareWithFlagTables(registerValueFromOpCode(opCode));
+}
+
+void CPU::executeCompareMemory(uint8_t opCode, uint16_t operand)
+{
+  compareWithFlagTables(registerM());
+}
+
+void CPU::executeCompareImmediate(uint8_t opCode, uint16_t operand)
+{
+  compareWithFlagTables(operand & 0xff);
+}
+
+void CPU::executePushRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  pushRegisterPairOnStack(registerPairFromOpCode(opCode));
+}
+
+void CPU::executePopRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  popStackToRegisterPair(registerPairFromOpCode(opCode));
+}
+
+void CPU::executePopAccumulatorAndStatus(uint8_t opCode, uint16_t operand)
+{
+  popStackToAccumulatorAndStatusPair();
+}
+
+void CPU::executePushAccumulatorAndStatus(uint8_t opCode, uint16_t operand)
+{
+  pushAccumulatorAndStatusPairOnStack();
+}
+
+void CPU::executeExchangeStackTopWithHL(uint8_t opCode, uint16_t operand)
+{
+  exchangeRegistersAndMemory();
+}
+
+void CPU::executeExchangeHLWithDE(uint8_t opCode, uint16_t operand)
+{
+  exchangeRegisterPairs(&registerPairs[REGISTER_PAIR_D], &registerPairs[REGISTER_PAIR_H]);
+}
+
+void CPU::executeLoadStackPointerFromHL(uint8_t opCode, uint16_t operand)
+{
+  stackPointer = currentMemoryAddress();
+}
+
+void CPU::executeJump(uint8_t opCode, uint16_t operand)
+{
+  if (followJumps)
+  {
+    programCounter = operand;
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+}
+
+void CPU::executeConditionalJump(uint8_t opCode, uint16_t operand)
+{
+  if (!followJumps)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    programCounter = operand;
+  }
+}
+
+void CPU::executeJumpToHL(uint8_t opCode, uint16_t operand)
+{
+  if (followJumps)
+  {
+    programCounter = currentMemoryAddress();
+  }
+}
+
+void CPU::executeCall(uint8_t opCode, uint16_t operand)
+{
+  if (followJumps)
+  {
+    push2ByteValueOnStack(programCounter);
+    programCounter = operand;
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+}
+
+void CPU::executeConditionalCall(uint8_t opCode, uint16_t operand)
+{
+  if (!followJumps)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    push2ByteValueOnStack(programCounter);
+    programCounter = operand;
+    cycles += branchTakenCycles(opCode);
+  }
+}
+
+void CPU::executeReturn(uint8_t opCode, uint16_t operand)
+{
+  if (followJumps)
+  {
+    programCounter = pop2ByteValueFromStack();
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+}
+
+void CPU::executeConditionalReturn(uint8_t opCode, uint16_t operand)
+{
+  if (!followJumps)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    programCounter = pop2ByteValueFromStack();
+    cycles += branchTakenCycles(opCode);
+  }
+}
+
+void CPU::executeRestart(uint8_t opCode, uint16_t operand)
+{
+  handleInterrupt(opCode);
+}
+
+void CPU::executeInput(uint8_t opCode, uint16_t operand)
+{
+  handleInputFromPort(operand & 0xff);
+}
+
+void CPU::executeOutput(uint8_t opCode, uint16_t operand)
+{
+  handleOutputToPort(operand & 0xff);
+}
+
+void CPU::executeDisableInterrupts(uint8_t opCode, uint16_t operand)
+{
+  ignoreInterrupts = true;
+}
+
+void CPU::executeEnableInterrupts(uint8_t opCode, uint16_t operand)
+{
+  ignoreInterrupts = false;
+}
+
+/*
+ * Fused pairs built by fuseMicroOpPair. Each runs its two instructions
+ * back to back, exactly as their own handlers would.
+ */
+
+// opCode is the DCR, operand the JNZ target
+void CPU::executeDecrementRegisterJumpIfNotZero(uint8_t opCode, uint16_t operand)
+{
+  decrementWithFlagTables(registerFromIndex(opCode >> 3 & 7));
+
+  if (!followJumps)
+  {
+    skipControlTransfer(JNZ);
+  }
+  else if (conditionMet(JNZ))
+  {
+    programCounter = operand;
+  }
+}
+
+// opCode is the MOV, operand the INX
+void CPU::executeMoveRegisterIncrementRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = *registerFromIndex(opCode & 7);
+  (*registerPairFromOpCode(operand))++;
+}
+
+// opCode is the MOV, operand the INX
+void CPU::executeMoveMemoryIncrementRegisterPair(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = registerM();
+  (*registerPairFromOpCode(operand))++;
+}
+
+// opCode is the LDAX, operand the STAX
+void CPU::executeLoadStoreAccumulatorIndirect(uint8_t opCode, uint16_t operand)
+{
+  registerA = memory[*registerPairFromOpCode(opCode)];
+  writeMemory(*registerPairFromOpCode(operand), registerA);
+}
+
+// opCode is the MVI, operand the port in the high byte and the value in the low
+void CPU::executeMoveImmediateOutput(uint8_t opCode, uint16_t operand)
+{
+  *registerFromIndex(opCode >> 3 & 7) = operand & 0xff;
+  handleOutputToPort(operand >> 8);
+}
+
+// opCode is the CPI value, operand the JZ target
+void CPU::executeCompareImmediateJumpIfZero(uint8_t opCode, uint16_t operand)
+{
+  compareWithFlagTables(opCode);
+
+  if (!followJumps)
+  {
+    skipControlTransfer(JZ);
+  }
+  else if (conditionMet(JZ))
+  {
+    programCounter = operand;
+  }
+}
+
+// opCode is the CPI value, operand the JNZ target
+void CPU::executeCompareImmediateJumpIfNotZero(uint8_t opCode, uint16_t operand)
+{
+  compareWithFlagTables(opCode);
+
+  if (!followJumps)
+  {
+    skipControlTransfer(JNZ);
+  }
+  else if (conditionMet(JNZ))
+  {
+    programCounter = operand;
+  }
+}
+
+/*
+ * Handlers removeDeadFlagUpdates gives instructions whose flag results are
+ * all overwritten before anything reads them. They only compute the result.
+ */
+
+void CPU::executeIncrementRegisterWithoutFlags(uint8_t opCode, uint16_t operand)
+{
+  (*registerFromIndex(opCode >> 3 & 7))++;
+}
+
+void CPU::executeDecrementRegisterWithoutFlags(uint8_t opCode, uint16_t operand)
+{
+  (*registerFromIndex(opCode >> 3 & 7))--;
+}
+
+// ADD, ADC, SUB, SBB, ANA, XRA and ORA, from a register, memory or an
+// immediate. ADC and SBB still read the carry.
+void CPU::executeArithmeticWithoutFlags(uint8_t opCode, uint16_t operand)
+{
+  uint8_t value;
+
+  if (opCode & 0x40)
+  {
+    value = operand & 0xff;
+  }
+  else
+  {
+    value = (opCode & 7) == REGISTER_M ? registerM() : registerValueFromOpCode(opCode);
+  }
+
+  switch (opCode >> 3 & 7)
+  {
+    case 0:
+      registerA += value;
+      break;
+    case 1:
+      registerA += value + carryBitSet();
+      break;
+    case 2:
+      registerA -= value;
+      break;
+    case 3:
+      registerA -= value + carryBitSet();
+      break;
+    case 4:
+      registerA &= value;
+      break;
+    case 5:
+      registerA ^= value;
+      break;
+    case 6:
+      registerA |= value;
+      break;
+  }
+}
+
+void CPU::executeAddRegisterPairToHWithoutFlags(uint8_t opCode, uint16_t operand)
+{
+  registerPairs[REGISTER_PAIR_H] += opCode == DAD_SP ? stackPointer : valueOfRegisterPair(registerPairFromOpCode(opCode));
+}
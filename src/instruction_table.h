@@ -0,0 +1,25 @@
+#ifndef INSTRUCTION_TABLE_H
+#define INSTRUCTION_TABLE_H
+
+#include <cstdint>
+
+class CPU;
+
+typedef void (CPU::*InstructionHandler)(uint8_t opCode, uint16_t operand);
+
+/*
+ * One entry per op code. The table core advances the program counter by
+ * length and adds cycles before calling the handler, so handlers only add
+ * the extra cycles of a taken conditional CALL or RET. A length of 0 leaves
+ * the program counter on the op code, as the switch core does for QUIT, RST
+ * and unhandled op codes. Both values are interpreterLength and
+ * interpreterCycles from op_code_info.h.
+ */
+struct Instruction
+{
+  InstructionHandler handler;
+  uint8_t length;
+  uint8_t cycles;
+};
+
+#endif
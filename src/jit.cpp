@@ -0,0 +1,496 @@
+#include <cstring>
+
+#include "cpu.h"
+#include "jit.h"
+
+#ifdef HAS_JIT
+
+#include <sys/mman.h>
+
+#define HOST_AL 0
+#define HOST_CL 1
+#define HOST_DL 2
+#define HOST_BL 3
+#define HOST_CH 5
+#define HOST_DH 6
+#define HOST_BH 7
+
+#define HOST_CX 1
+#define HOST_DX 2
+#define HOST_BX 3
+
+#define OPERAND_SIZE_16 0x66
+
+/*
+ * Inside a compiled block the guest registers live in the legacy byte
+ * registers, so each pair maps onto a 16-bit host register: BC in cx, DE in
+ * dx and HL in bx, with A in al. None of these need a REX prefix, which
+ * keeps ch, dh and bh addressable. M and SP have no host register, since
+ * the instructions that use them are never emitted inline.
+ */
+static const uint8_t hostRegisters[8] = {
+  HOST_CH, HOST_CL, HOST_DH, HOST_DL, HOST_BH, HOST_BL, 0xff, HOST_AL
+};
+
+static const uint8_t hostRegisterPairs[4] = { HOST_CX, HOST_DX, HOST_BX, 0xff };
+
+JitArena::JitArena() : base(NULL), used(0)
+{
+}
+
+JitArena::JitArena(const JitArena &other) : base(NULL), used(0)
+{
+}
+
+JitArena::~JitArena()
+{
+  release();
+}
+
+JitArena &JitArena::operator=(const JitArena &other)
+{
+  release();
+  return *this;
+}
+
+uint8_t *JitArena::beginBlock()
+{
+  if (!base)
+  {
+    void *pages = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    if (pages == MAP_FAILED)
+    {
+      return NULL;
+    }
+
+    base = (uint8_t *)pages;
+  }
+  else if (mprotect(base, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE) != 0)
+  {
+    return NULL;
+  }
+
+  if (used + MAX_COMPILED_BLOCK_SIZE > JIT_ARENA_SIZE)
+  {
+    return NULL;
+  }
+
+  return base + used;
+}
+
+void JitArena::endBlock(uint8_t *end)
+{
+  used = (end - base + 15) & ~(size_t)15;
+  mprotect(base, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC);
+}
+
+void JitArena::reset()
+{
+  used = 0;
+}
+
+void JitArena::release()
+{
+  if (base)
+  {
+    munmap(base, JIT_ARENA_SIZE);
+  }
+
+  base = NULL;
+  used = 0;
+}
+
+JitEmitter::JitEmitter(uint8_t *code) : code(code)
+{
+}
+
+void JitEmitter::emit(uint8_t byte)
+{
+  *code++ = byte;
+}
+
+void JitEmitter::emit(uint8_t first, uint8_t second)
+{
+  emit(first);
+  emit(second);
+}
+
+void JitEmitter::emit(uint8_t first, uint8_t second, uint8_t third)
+{
+  emit(first);
+  emit(second);
+  emit(third);
+}
+
+void JitEmitter::emit16(uint16_t value)
+{
+  memcpy(code, &value, 2);
+  code += 2;
+}
+
+void JitEmitter::emit32(uint32_t value)
+{
+  memcpy(code, &value, 4);
+  code += 4;
+}
+
+void JitEmitter::emit64(uint64_t value)
+{
+  memcpy(code, &value, 8);
+  code += 8;
+}
+
+// [prefix] REX.B opCode modrm(disp32, reg, [r12 + disp32])
+void JitEmitter::emitCPUFieldAccess(uint8_t prefix, uint8_t opCode, uint8_t reg, int32_t offset)
+{
+  if (prefix)
+  {
+    emit(prefix);
+  }
+
+  emit(0x41, opCode, 0x84 | reg << 3);
+  emit(0x24);
+  emit32(offset);
+}
+
+// REX.W REX.B opCode modrm(disp32, reg, [r12 + disp32])
+void JitEmitter::emitWideCPUFieldAccess(uint8_t opCode, uint8_t reg, int32_t offset)
+{
+  emit(0x49, opCode, 0x84 | reg << 3);
+  emit(0x24);
+  emit32(offset);
+}
+
+/*
+ * A block is compiled only if none of its instructions can leave the CPU or
+ * throw: I/O, HLT, QUIT, RST and unhandled op codes stay interpreted. Code
+ * the program wrote into RAM is compiled like any other, since a store into
+ * a block's pages retires the block and its code with it.
+ */
+bool CPU::canCompile(Block *block)
+{
+  for (size_t i = 0; i < block->ops.size(); i++)
+  {
+    InstructionHandler handler = block->ops[i].handler;
+
+    if (block->ops[i].length == 0 || handler == &CPU::executeInput ||
+      handler == &CPU::executeOutput || handler == &CPU::executeMoveImmediateOutput ||
+      handler == &CPU::executeHalt)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool CPU::compileBlock(Block *block)
+{
+  if (!canCompile(block))
+  {
+    return false;
+  }
+
+  uint8_t *start = jitArena.beginBlock();
+
+  if (!start)
+  {
+    // The arena is full. Drop every block so compilation starts over.
+    invalidateCode();
+    jitArena.reset();
+    return false;
+  }
+
+  jitArena.endBlock(emitBlock(block, start));
+  block->code = (CompiledBlock)start;
+  return true;
+}
+
+/*
+ * Compiles a block that has just become hot. With background compilation
+ * the block is queued and keeps running in the interpreter until
+ * installCompiledBlocks() picks up its code, so this never waits and only
+ * returns true when the code is ready to run now.
+ */
+bool CPU::compileHotBlock(Block *block)
+{
+  if (!backgroundCompilation)
+  {
+    return compileBlock(block);
+  }
+
+  if (!canCompile(block))
+  {
+    return false;
+  }
+
+  block->compiling = backgroundCompiler.queue(this, block);
+
+  if (!block->compiling)
+  {
+    // The queue is full, so try again once the block is hot again.
+    block->executions = 0;
+  }
+
+  return false;
+}
+
+/*
+ * Copies the code the compiler thread has finished into the arena, between
+ * blocks, since the arena is only writable while nothing runs from it. Code
+ * for a block that a store retired meanwhile is thrown away.
+ */
+void CPU::installCompiledBlocks()
+{
+  CompiledCode *result;
+
+  while ((result = backgroundCompiler.takeResult()))
+  {
+    Block *block = result->block;
+
+    block->compiling = false;
+
+    if (!block->retired)
+    {
+      uint8_t *start = jitArena.beginBlock();
+
+      if (start)
+      {
+        memcpy(start, result->bytes, result->size);
+        jitArena.endBlock(start + result->size);
+        block->code = (CompiledBlock)start;
+      }
+      else
+      {
+        invalidateCode();
+        jitArena.reset();
+      }
+    }
+
+    delete result;
+  }
+}
+
+/*
+ * Emits the code for a block at start and returns where it ends. Anything
+ * outside the block is reached by absolute address and its exits by relative
+ * jumps, so the code can be emitted into a buffer and copied into the arena
+ * later. This also runs on the compiler thread, so it reads nothing but the
+ * block and the layout of the CPU.
+ */
+uint8_t *CPU::emitBlock(Block *block, uint8_t *start)
+{
+  JitEmitter emitter(start);
+  int32_t registersOffset = (uint8_t *)registers - (uint8_t *)this;
+  int32_t accumulatorOffset = &registerA - (uint8_t *)this;
+  int32_t programCounterOffset = (uint8_t *)&programCounter - (uint8_t *)this;
+  int32_t cyclesOffset = (uint8_t *)&cycles - (uint8_t *)this;
+  int32_t codeInvalidatedOffset = (uint8_t *)&blockCache.codeInvalidated - (uint8_t *)this;
+  uint16_t address = block->address;
+  uint32_t pendingCycles = 0;
+  vector<uint8_t *> exits;
+
+  // push rbx; push r12; push r14; mov r12, rdi; mov r14, memory
+  emitter.emit(0x53);
+  emitter.emit(0x41, 0x54);
+  emitter.emit(0x41, 0x56);
+  emitter.emit(0x49, 0x89, 0xfc);
+  emitter.emit(0x49, 0xbe);
+  emitter.emit64((uint64_t)memory.data());
+  emitGuestRegisterLoad(emitter, registersOffset, accumulatorOffset);
+
+  for (size_t i = 0; i < block->ops.size(); i++)
+  {
+    const MicroOp &op = block->ops[i];
+
+    address += op.length;
+    pendingCycles += op.cycles;
+
+    if (emitNativeOp(emitter, op))
+    {
+      continue;
+    }
+
+    // Hand the instruction to its interpreter handler, with the program
+    // counter and cycle count exactly as executeMicroOp leaves them.
+    emitGuestRegisterStore(emitter, registersOffset, accumulatorOffset);
+    emitter.emitCPUFieldAccess(OPERAND_SIZE_16, 0xc7, 0, programCounterOffset);
+    emitter.emit16(address);
+    emitter.emitWideCPUFieldAccess(0x81, 0, cyclesOffset);
+    emitter.emit32(pendingCycles);
+    pendingCycles = 0;
+
+    // mov rdi, r12; mov rsi, &op; mov rax, executeCallOut; call rax
+    emitter.emit(0x4c, 0x89, 0xe7);
+    emitter.emit(0x48, 0xbe);
+    emitter.emit64((uint64_t)&op);
+    emitter.emit(0x48, 0xb8);
+    emitter.emit64((uint64_t)&CPU::executeCallOut);
+    emitter.emit(0xff, 0xd0);
+
+    // A store into decoded code ends the block, as in executeBlock.
+    emitter.emitCPUFieldAccess(0, 0x80, 7, codeInvalidatedOffset);
+    emitter.emit(0x00);
+    emitter.emit(0x0f, 0x85);
+    exits.push_back(emitter.code);
+    emitter.emit32(0);
+
+    emitGuestRegisterLoad(emitter, registersOffset, accumulatorOffset);
+  }
+
+  emitGuestRegisterStore(emitter, registersOffset, accumulatorOffset);
+
+  if (emitsNatively(block->ops.back()))
+  {
+    emitter.emitCPUFieldAccess(OPERAND_SIZE_16, 0xc7, 0, programCounterOffset);
+    emitter.emit16(address);
+  }
+
+  if (pendingCycles > 0)
+  {
+    emitter.emitWideCPUFieldAccess(0x81, 0, cyclesOffset);
+    emitter.emit32(pendingCycles);
+  }
+
+  for (size_t i = 0; i < exits.size(); i++)
+  {
+    int32_t distance = emitter.code - (exits[i] + 4);
+
+    memcpy(exits[i], &distance, 4);
+  }
+
+  // pop r14; pop r12; pop rbx; ret
+  emitter.emit(0x41, 0x5e);
+  emitter.emit(0x41, 0x5c);
+  emitter.emit(0x5b);
+  emitter.emit(0xc3);
+
+  return emitter.code;
+}
+
+void CPU::executeCallOut(CPU *cpu, const MicroOp *op)
+{
+  (cpu->*op->handler)(op->opCode, op->operand);
+}
+
+void CPU::emitGuestRegisterLoad(JitEmitter &emitter, int32_t registersOffset, int32_t accumulatorOffset)
+{
+  for (int pair = 0; pair < 3; pair++)
+  {
+    emitter.emitCPUFieldAccess(OPERAND_SIZE_16, 0x8b, hostRegisterPairs[pair], registersOffset + pair * 2);
+  }
+
+  emitter.emitCPUFieldAccess(0, 0x8a, HOST_AL, accumulatorOffset);
+}
+
+void CPU::emitGuestRegisterStore(JitEmitter &emitter, int32_t registersOffset, int32_t accumulatorOffset)
+{
+  for (int pair = 0; pair < 3; pair++)
+  {
+    emitter.emitCPUFieldAccess(OPERAND_SIZE_16, 0x89, hostRegisterPairs[pair], registersOffset + pair * 2);
+  }
+
+  emitter.emitCPUFieldAccess(0, 0x88, HOST_AL, accumulatorOffset);
+}
+
+/*
+ * Data movement that touches neither the flags nor memory writes is emitted
+ * inline. Everything else goes through executeCallOut.
+ */
+bool CPU::emitsNatively(const MicroOp &op)
+{
+  InstructionHandler handler = op.handler;
+
+  return handler == &CPU::executeNoOperation ||
+    handler == &CPU::executeMoveRegisterToRegister ||
+    handler == &CPU::executeMoveImmediate ||
+    handler == &CPU::executeMoveMemoryToRegister ||
+    handler == &CPU::executeLoadRegisterPairImmediate ||
+    handler == &CPU::executeIncrementRegisterPair ||
+    handler == &CPU::executeDecrementRegisterPair ||
+    handler == &CPU::executeExchangeHLWithDE ||
+    handler == &CPU::executeLoadAccumulatorIndirect ||
+    handler == &CPU::executeLoadAccumulatorDirect ||
+    (handler == &CPU::executeLoadHLDirect && op.operand != 0xffff) ||
+    handler == &CPU::executeComplementAccumulator;
+}
+
+bool CPU::emitNativeOp(JitEmitter &emitter, const MicroOp &op)
+{
+  InstructionHandler handler = op.handler;
+  uint8_t pair = hostRegisterPairs[(op.opCode >> 4) & 3];
+
+  if (!emitsNatively(op))
+  {
+    return false;
+  }
+
+  if (handler == &CPU::executeMoveRegisterToRegister)
+  {
+    // mov dst8, src8
+    emitter.emit(0x88, 0xc0 | hostRegisters[op.opCode & 7] << 3 | hostRegisters[op.opCode >> 3 & 7]);
+  }
+  else if (handler == &CPU::executeMoveImmediate)
+  {
+    // mov dst8, imm8
+    emitter.emit(0xb0 | hostRegisters[op.opCode >> 3 & 7], op.operand & 0xff);
+  }
+  else if (handler == &CPU::executeMoveMemoryToRegister)
+  {
+    // movzx esi, bx; add rsi, r14; mov dst8, [rsi]
+    emitter.emit(0x0f, 0xb7, 0xf3);
+    emitter.emit(0x4c, 0x01, 0xf6);
+    emitter.emit(0x8a, 0x06 | hostRegisters[op.opCode >> 3 & 7] << 3);
+  }
+  else if (handler == &CPU::executeLoadRegisterPairImmediate)
+  {
+    // mov pair16, imm16
+    emitter.emit(OPERAND_SIZE_16, 0xb8 | pair);
+    emitter.emit16(op.operand);
+  }
+  else if (handler == &CPU::executeIncrementRegisterPair)
+  {
+    // inc pair16
+    emitter.emit(OPERAND_SIZE_16, 0xff, 0xc0 | pair);
+  }
+  else if (handler == &CPU::executeDecrementRegisterPair)
+  {
+    // dec pair16
+    emitter.emit(OPERAND_SIZE_16, 0xff, 0xc8 | pair);
+  }
+  else if (handler == &CPU::executeExchangeHLWithDE)
+  {
+    // xchg dx, bx
+    emitter.emit(OPERAND_SIZE_16, 0x87, 0xd3);
+  }
+  else if (handler == &CPU::executeLoadAccumulatorIndirect)
+  {
+    // movzx esi, pair16; add rsi, r14; mov al, [rsi]
+    emitter.emit(0x0f, 0xb7, 0xf0 | pair);
+    emitter.emit(0x4c, 0x01, 0xf6);
+    emitter.emit(0x8a, 0x06);
+  }
+  else if (handler == &CPU::executeLoadAccumulatorDirect)
+  {
+    // mov al, [r14 + operand]
+    emitter.emit(0x41, 0x8a, 0x86);
+    emitter.emit32(op.operand);
+  }
+  else if (handler == &CPU::executeLoadHLDirect)
+  {
+    // mov bx, [r14 + operand]
+    emitter.emit(OPERAND_SIZE_16, 0x41, 0x8b);
+    emitter.emit(0x9e);
+    emitter.emit32(op.operand);
+  }
+  else if (handler == &CPU::executeComplementAccumulator)
+  {
+    // not al
+    emitter.emit(0xf6, 0xd0);
+  }
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The JIT emits x86-64 code into pages it maps itself, so it is only built
+// for x86-64 Linux and macOS with GCC or Clang. Build with -DNO_JIT to fall
+// back to the block core.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && (defined(__linux__) || defined(__APPLE__)) && !defined(NO_JIT)
+#define HAS_JIT
+#endif
+
+#define JIT_THRESHOLD 8
+#define JIT_ARENA_SIZE (256 * 1024)
+#define MAX_COMPILED_BLOCK_SIZE 4096
+
+/*
+ * Executable memory for compiled blocks. The arena is mapped on first use
+ * and is only writable while a block is being emitted into it. Copying a
+ * CPU gives the copy an empty arena of its own.
+ */
+class JitArena
+{
+  public:
+    JitArena();
+    JitArena(const JitArena &other);
+    ~JitArena();
+    JitArena &operator=(const JitArena &other);
+    uint8_t *beginBlock();
+    void endBlock(uint8_t *end);
+    void reset();
+
+  private:
+    uint8_t *base;
+    size_t used;
+    void release();
+};
+
+/*
+ * Appends x86-64 machine code at a cursor. The CPU fields a block touches
+ * are addressed relative to the CPU pointer, which compiled code keeps in
+ * r12, so one compiled block only ever runs against the CPU that built it.
+ */
+class JitEmitter
+{
+  public:
+    JitEmitter(uint8_t *code);
+    uint8_t *code;
+    void emit(uint8_t byte);
+    void emit(uint8_t first, uint8_t second);
+    void emit(uint8_t first, uint8_t second, uint8_t third);
+    void emit16(uint16_t value);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void emitCPUFieldAccess(uint8_t prefix, uint8_t opCode, uint8_t reg, int32_t offset);
+    void emitWideCPUFieldAccess(uint8_t opCode, uint8_t reg, int32_t offset);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#include "lockstep.h"
+
+static string hexValue(unsigned value, int digits)
+{
+  char text[16];
+
+  snprintf(text, sizeof(text), "0x%0*x", digits, value);
+  return text;
+}
+
+static string faultName(CPU *cpu)
+{
+  return cpu->fault() == NO_FAULT ? "none" : "\"" + cpu->faultMessage() + "\"";
+}
+
+Lockstep::Lockstep(CPU *reference, CPU *candidate) : checkInterval(DEFAULT_LOCKSTEP_INTERVAL), reference(reference), candidate(candidate), lastMatch(0), mismatchCycle(0)
+{
+}
+
+/*
+ * Runs both CPUs until the candidate reaches cycle, like CPU::runUntil.
+ * Returns the cycles the candidate ran past cycle, which is negative if the
+ * program ended or the cores diverged first.
+ */
+int64_t Lockstep::runUntil(uint64_t cycle)
+{
+  candidate->dispatchDueEvents();
+  reference->dispatchDueEvents();
+
+  while (!diverged() && candidate->cycles < cycle)
+  {
+    uint64_t boundary = min(min(candidate->scheduler.nextEventCycle(), cycle), candidate->cycles + checkInterval);
+    int64_t overshoot = candidate->runCycles(boundary - candidate->cycles);
+
+    // The candidate stops between instructions, so a reference that agrees
+    // lands on the same cycle. runCycles always runs one instruction, so it
+    // is not called with an empty budget.
+    if (reference->cycles < candidate->cycles)
+    {
+      reference->runCycles(candidate->cycles - reference->cycles);
+    }
+
+    // The reference ran up to the candidate's cycle count, and a faulting
+    // instruction adds none, so a reference that agrees stopped before the
+    // instruction the candidate faulted on. One more instruction runs it.
+    if (candidate->fault() != NO_FAULT && reference->fault() == NO_FAULT)
+    {
+      reference->runCycles(1);
+    }
+
+    if (!sameState() || overshoot < 0)
+    {
+      break;
+    }
+
+    candidate->dispatchDueEvents();
+    reference->dispatchDueEvents();
+  }
+
+  return (int64_t)(candidate->cycles - cycle);
+}
+
+bool Lockstep::diverged()
+{
+  return !mismatch.empty();
+}
+
+uint64_t Lockstep::divergenceCycle()
+{
+  return mismatchCycle;
+}
+
+/*
+ * The first difference found, and the cycles between which it happened, or
+ * an empty string if the cores still agree.
+ */
+string Lockstep::divergence()
+{
+  return mismatch;
+}
+
+bool Lockstep::sameState()
+{
+  static const char *registerNames = "BCDEHLMA";
+
+  if (candidate->cycles != reference->cycles)
+  {
+    reportMismatch("the cycle count", to_string(candidate->cycles), to_string(reference->cycles));
+    return false;
+  }
+
+  for (int index = 0; index < 8; index++)
+  {
+    uint8_t candidateValue = *candidate->registerFromIndex(index);
+    uint8_t referenceValue = *reference->registerFromIndex(index);
+
+    if (index != REGISTER_M && candidateValue != referenceValue)
+    {
+      reportMismatch(string("register ") + registerNames[index], hexValue(candidateValue, 2), hexValue(referenceValue, 2));
+      return false;
+    }
+  }
+
+  if (candidate->statusRegister() != reference->statusRegister())
+  {
+    reportMismatch("the status register", hexValue(candidate->statusRegister(), 2), hexValue(reference->statusRegister(), 2));
+    return false;
+  }
+
+  if (candidate->programCounter != reference->programCounter)
+  {
+    reportMismatch("the program counter", hexValue(candidate->programCounter, 4), hexValue(reference->programCounter, 4));
+    return false;
+  }
+
+  if (candidate->stackPointer != reference->stackPointer)
+  {
+    reportMismatch("the stack pointer", hexValue(candidate->stackPointer, 4), hexValue(reference->stackPointer, 4));
+    return false;
+  }
+
+  if (candidate->halt != reference->halt)
+  {
+    reportMismatch("halted", candidate->halt ? "true" : "false", reference->halt ? "true" : "false");
+    return false;
+  }
+
+  if (candidate->fault() != reference->fault())
+  {
+    reportMismatch("the fault", faultName(candidate), faultName(reference));
+    return false;
+  }
+
+  pair<vector<uint8_t>::iterator, vector<uint8_t>::iterator> difference = std::mismatch(candidate->memory.begin(), candidate->memory.end(), reference->memory.begin());
+
+  if (difference.first != candidate->memory.end())
+  {
+    reportMismatch("memory at " + hexValue(difference.first - candidate->memory.begin(), 4), hexValue(*difference.first, 2), hexValue(*difference.second, 2));
+    return false;
+  }
+
+  lastMatch = candidate->cycles;
+  return true;
+}
+
+void Lockstep::reportMismatch(string what, string candidateValue, string referenceValue)
+{
+  mismatchCycle = candidate->cycles;
+  mismatch = "at cycle " + to_string(mismatchCycle) + " (last matched at cycle " + to_string(lastMatch) + "): " + what + " is " + candidateValue + " on the " + CPU::nameOfCore(candidate->core) + " core and " + referenceValue + " on the " + CPU::nameOfCore(reference->core) + " core";
+}
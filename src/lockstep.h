@@ -0,0 +1,42 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <cstdint>
+#include <string>
+
+#include "cpu.h"
+
+#define DEFAULT_LOCKSTEP_INTERVAL 1000
+
+using namespace std;
+
+/*
+ * Runs a candidate core next to a reference core, normally the switch core,
+ * and stops at the first check where their registers, memory, cycle counts
+ * or faults disagree. The candidate runs up to each check, at most
+ * checkInterval cycles apart and at every scheduled event, and the
+ * reference then runs to the cycle the candidate stopped on. Both CPUs need
+ * the same program and devices of their own. The events of both are
+ * dispatched at the same cycle, so they see the same interrupts.
+ */
+class Lockstep
+{
+  public:
+    Lockstep(CPU *reference, CPU *candidate);
+    uint64_t checkInterval;
+    int64_t runUntil(uint64_t cycle);
+    bool diverged();
+    uint64_t divergenceCycle();
+    string divergence();
+
+  private:
+    CPU *reference;
+    CPU *candidate;
+    uint64_t lastMatch;
+    uint64_t mismatchCycle;
+    string mismatch;
+    bool sameState();
+    void reportMismatch(string what, string candidateValue, string referenceValue);
+};
+
+#endif
@@ -1,8 +1,28 @@
+#include <cstring>
+#include <stdio.h>
+
 #include "cabinet.h"
 
-int main(void) 
+int main(int argc, char *argv[])
 {
   Cabinet cabinet;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--core") == 0 && i + 1 < argc)
+    {
+      if (!CPU::coreFromName(argv[++i], &cabinet.core))
+      {
+        printf("Unknown CPU core: %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--lockstep") == 0)
+    {
+      cabinet.lockstep = true;
+    }
+  }
+
   cabinet.bootstrap();
 
   return 0;
@@ -0,0 +1,27 @@
+#include <cstdio>
+
+#include "op_code_info.h"
+
+constexpr OpCodeInfo OpCodeTable::entries[256];
+
+/*
+ * Writes the instruction at code as text and returns its length. Only the
+ * bytes the instruction occupies are read.
+ */
+uint8_t disassembleInstruction(const uint8_t *code, char *text, size_t size)
+{
+  const OpCodeInfo &info = opCodeInfo(code[0]);
+  uint16_t operand = 0;
+
+  if (info.length == 2)
+  {
+    operand = code[1];
+  }
+  else if (info.length == 3)
+  {
+    operand = code[2] << 8 | code[1];
+  }
+
+  snprintf(text, size, info.mnemonic, operand);
+  return info.length;
+}
@@ -0,0 +1,357 @@
+#ifndef OP_CODE_INFO_H
+#define OP_CODE_INFO_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "status_bits.h"
+
+/*
+ * Register bits follow the REGISTER_* indices in cpu.h, so bit n is register
+ * index n. Bit 6 (M) is never set: memory operands are described by the
+ * OP_CODE_READS_MEMORY and OP_CODE_WRITES_MEMORY attributes along with the
+ * registers that form the address.
+ */
+#define REGISTER_BIT_B 0x001
+#define REGISTER_BIT_C 0x002
+#define REGISTER_BIT_D 0x004
+#define REGISTER_BIT_E 0x008
+#define REGISTER_BIT_H 0x010
+#define REGISTER_BIT_L 0x020
+#define REGISTER_BIT_A 0x080
+#define REGISTER_BIT_SP 0x100
+
+#define REGISTER_BITS_BC (REGISTER_BIT_B | REGISTER_BIT_C)
+#define REGISTER_BITS_DE (REGISTER_BIT_D | REGISTER_BIT_E)
+#define REGISTER_BITS_HL (REGISTER_BIT_H | REGISTER_BIT_L)
+
+#define OP_CODE_JUMP 0x001
+#define OP_CODE_CALL 0x002
+#define OP_CODE_RETURN 0x004
+#define OP_CODE_CONDITIONAL 0x008
+#define OP_CODE_RESTART 0x010
+#define OP_CODE_HALT 0x020
+#define OP_CODE_IO 0x040
+#define OP_CODE_READS_MEMORY 0x080
+#define OP_CODE_WRITES_MEMORY 0x100
+#define OP_CODE_INTERRUPTS 0x200
+#define OP_CODE_QUIT 0x400
+#define OP_CODE_UNDEFINED 0x800
+#define OP_CODE_TRAP 0x1000
+
+#define OP_CODE_ENDS_BLOCK (OP_CODE_JUMP | OP_CODE_CALL | OP_CODE_RETURN | OP_CODE_HALT | OP_CODE_TRAP)
+
+/*
+ * What the decoder, the interpreters and the tools need to know about one op
+ * code. The mnemonic is a printf format taking the immediate operand. Cycles
+ * are the cost of a conditional CALL or RET that is not taken, takenCycles
+ * the cost when it is; the two are equal for everything else. Flags are
+ * status register bits and describe what this emulator's handlers do, e.g.
+ * DCR leaves AC alone and the logical ops do not write it.
+ *
+ * Trap op codes (QUIT, RST and the undefined ones) are dispatched with the
+ * program counter still on the op code and do their own accounting, as RST
+ * shares its path with an external interrupt.
+ */
+struct OpCodeInfo
+{
+  const char *mnemonic;
+  uint8_t length;
+  uint8_t cycles;
+  uint8_t takenCycles;
+  uint8_t flagsRead;
+  uint8_t flagsWritten;
+  uint16_t registersRead;
+  uint16_t registersWritten;
+  uint16_t attributes;
+};
+
+struct OpCodeTable
+{
+  static constexpr OpCodeInfo entries[256] = {
+    { "NOP", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x00 NOP
+    { "LXI B,0x%04x", 3, 10, 10, 0, 0, 0, REGISTER_BITS_BC, 0 }, // 0x01 LXI_B
+    { "STAX B", 1, 7, 7, 0, 0, REGISTER_BIT_A | REGISTER_BITS_BC, 0, OP_CODE_WRITES_MEMORY }, // 0x02 STAX_B
+    { "INX B", 1, 5, 5, 0, 0, REGISTER_BITS_BC, REGISTER_BITS_BC, 0 }, // 0x03 INX_B
+    { "INR B", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_B, REGISTER_BIT_B, 0 }, // 0x04 INR_B
+    { "DCR B", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_B, REGISTER_BIT_B, 0 }, // 0x05 DCR_B
+    { "MVI B,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_B, 0 }, // 0x06 MVI_B
+    { "RLC", 1, 4, 4, 0, CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x07 RLC
+    { "QUIT", 1, 0, 0, 0, 0, 0, 0, OP_CODE_QUIT | OP_CODE_TRAP }, // 0x08 QUIT
+    { "DAD B", 1, 10, 10, 0, CARRY_BIT, REGISTER_BITS_HL | REGISTER_BITS_BC, REGISTER_BITS_HL, 0 }, // 0x09 DAD_B
+    { "LDAX B", 1, 7, 7, 0, 0, REGISTER_BITS_BC, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x0a LDX_B
+    { "DCX B", 1, 5, 5, 0, 0, REGISTER_BITS_BC, REGISTER_BITS_BC, 0 }, // 0x0b DCX_B
+    { "INR C", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_C, REGISTER_BIT_C, 0 }, // 0x0c INR_C
+    { "DCR C", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_C, REGISTER_BIT_C, 0 }, // 0x0d DCR_C
+    { "MVI C,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_C, 0 }, // 0x0e MVI_C
+    { "RRC", 1, 4, 4, 0, CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x0f RRC
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x10 -
+    { "LXI D,0x%04x", 3, 10, 10, 0, 0, 0, REGISTER_BITS_DE, 0 }, // 0x11 LXI_D
+    { "STAX D", 1, 7, 7, 0, 0, REGISTER_BIT_A | REGISTER_BITS_DE, 0, OP_CODE_WRITES_MEMORY }, // 0x12 STAX_D
+    { "INX D", 1, 5, 5, 0, 0, REGISTER_BITS_DE, REGISTER_BITS_DE, 0 }, // 0x13 INX_D
+    { "INR D", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_D, REGISTER_BIT_D, 0 }, // 0x14 INR_D
+    { "DCR D", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_D, REGISTER_BIT_D, 0 }, // 0x15 DCR_D
+    { "MVI D,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_D, 0 }, // 0x16 MVI_D
+    { "RAL", 1, 4, 4, CARRY_BIT, CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x17 RAL
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x18 -
+    { "DAD D", 1, 10, 10, 0, CARRY_BIT, REGISTER_BITS_HL | REGISTER_BITS_DE, REGISTER_BITS_HL, 0 }, // 0x19 DAD_D
+    { "LDAX D", 1, 7, 7, 0, 0, REGISTER_BITS_DE, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x1a LDX_D
+    { "DCX D", 1, 5, 5, 0, 0, REGISTER_BITS_DE, REGISTER_BITS_DE, 0 }, // 0x1b DCX_D
+    { "INR E", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_E, REGISTER_BIT_E, 0 }, // 0x1c INR_E
+    { "DCR E", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_E, REGISTER_BIT_E, 0 }, // 0x1d DCR_E
+    { "MVI E,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_E, 0 }, // 0x1e MVI_E
+    { "RAR", 1, 4, 4, CARRY_BIT, CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x1f RAR
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x20 -
+    { "LXI H,0x%04x", 3, 10, 10, 0, 0, 0, REGISTER_BITS_HL, 0 }, // 0x21 LXI_H
+    { "SHLD 0x%04x", 3, 16, 16, 0, 0, REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x22 SHLD
+    { "INX H", 1, 5, 5, 0, 0, REGISTER_BITS_HL, REGISTER_BITS_HL, 0 }, // 0x23 INX_H
+    { "INR H", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_H, REGISTER_BIT_H, 0 }, // 0x24 INR_H
+    { "DCR H", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_H, REGISTER_BIT_H, 0 }, // 0x25 DCR_H
+    { "MVI H,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_H, 0 }, // 0x26 MVI_H
+    { "DAA", 1, 4, 4, AUXILIARY_CARRY_BIT | CARRY_BIT, AUXILIARY_CARRY_BIT | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x27 DAA
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x28 -
+    { "DAD H", 1, 10, 10, 0, CARRY_BIT, REGISTER_BITS_HL, REGISTER_BITS_HL, 0 }, // 0x29 DAD_H
+    { "LHLD 0x%04x", 3, 16, 16, 0, 0, 0, REGISTER_BITS_HL, OP_CODE_READS_MEMORY }, // 0x2a LXLD
+    { "DCX H", 1, 5, 5, 0, 0, REGISTER_BITS_HL, REGISTER_BITS_HL, 0 }, // 0x2b DCX_H
+    { "INR L", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_L, REGISTER_BIT_L, 0 }, // 0x2c INR_L
+    { "DCR L", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_L, REGISTER_BIT_L, 0 }, // 0x2d DCR_L
+    { "MVI L,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_L, 0 }, // 0x2e MVI_L
+    { "CMA", 1, 4, 4, 0, 0, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x2f CMA
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x30 -
+    { "LXI SP,0x%04x", 3, 10, 10, 0, 0, 0, REGISTER_BIT_SP, 0 }, // 0x31 LXI_SP
+    { "STA 0x%04x", 3, 13, 13, 0, 0, REGISTER_BIT_A, 0, OP_CODE_WRITES_MEMORY }, // 0x32 STA
+    { "INX SP", 1, 5, 5, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, 0 }, // 0x33 INX_SP
+    { "INR M", 1, 10, 10, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BITS_HL, 0, OP_CODE_READS_MEMORY | OP_CODE_WRITES_MEMORY }, // 0x34 INR_M
+    { "DCR M", 1, 10, 10, 0, SZP_BITS, REGISTER_BITS_HL, 0, OP_CODE_READS_MEMORY | OP_CODE_WRITES_MEMORY }, // 0x35 DCR_M
+    { "MVI M,0x%02x", 2, 10, 10, 0, 0, REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x36 MVI_M
+    { "STC", 1, 4, 4, 0, CARRY_BIT, 0, 0, 0 }, // 0x37 STC
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0x38 -
+    { "DAD SP", 1, 10, 10, 0, CARRY_BIT, REGISTER_BITS_HL | REGISTER_BIT_SP, REGISTER_BITS_HL, 0 }, // 0x39 DAD_SP
+    { "LDA 0x%04x", 3, 13, 13, 0, 0, 0, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x3a LDA
+    { "DCX SP", 1, 5, 5, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, 0 }, // 0x3b DCX_SP
+    { "INR A", 1, 5, 5, 0, SZP_BITS | AUXILIARY_CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x3c INR_A
+    { "DCR A", 1, 5, 5, 0, SZP_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x3d DCR_A
+    { "MVI A,0x%02x", 2, 7, 7, 0, 0, 0, REGISTER_BIT_A, 0 }, // 0x3e MVI_A
+    { "CMC", 1, 4, 4, CARRY_BIT, CARRY_BIT, 0, 0, 0 }, // 0x3f CMC
+    { "MOV B,B", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x40 MOV_B_B
+    { "MOV B,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_B, 0 }, // 0x41 MOV_B_C
+    { "MOV B,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_B, 0 }, // 0x42 MOV_B_D
+    { "MOV B,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_B, 0 }, // 0x43 MOV_B_E
+    { "MOV B,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_B, 0 }, // 0x44 MOV_B_H
+    { "MOV B,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_B, 0 }, // 0x45 MOV_B_L
+    { "MOV B,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_B, OP_CODE_READS_MEMORY }, // 0x46 MOV_B_M
+    { "MOV B,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_B, 0 }, // 0x47 MOV_B_A
+    { "MOV C,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_C, 0 }, // 0x48 MOV_C_B
+    { "MOV C,C", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x49 MOV_C_C
+    { "MOV C,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_C, 0 }, // 0x4a MOV_C_D
+    { "MOV C,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_C, 0 }, // 0x4b MOV_C_E
+    { "MOV C,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_C, 0 }, // 0x4c MOV_C_H
+    { "MOV C,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_C, 0 }, // 0x4d MOV_C_L
+    { "MOV C,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_C, OP_CODE_READS_MEMORY }, // 0x4e MOV_C_M
+    { "MOV C,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_C, 0 }, // 0x4f MOV_C_A
+    { "MOV D,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_D, 0 }, // 0x50 MOV_D_B
+    { "MOV D,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_D, 0 }, // 0x51 MOV_D_C
+    { "MOV D,D", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x52 MOV_D_D
+    { "MOV D,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_D, 0 }, // 0x53 MOV_D_E
+    { "MOV D,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_D, 0 }, // 0x54 MOV_D_H
+    { "MOV D,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_D, 0 }, // 0x55 MOV_D_L
+    { "MOV D,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_D, OP_CODE_READS_MEMORY }, // 0x56 MOV_D_M
+    { "MOV D,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_D, 0 }, // 0x57 MOV_D_A
+    { "MOV E,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_E, 0 }, // 0x58 MOV_E_B
+    { "MOV E,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_E, 0 }, // 0x59 MOV_E_C
+    { "MOV E,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_E, 0 }, // 0x5a MOV_E_D
+    { "MOV E,E", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x5b MOV_E_E
+    { "MOV E,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_E, 0 }, // 0x5c MOV_E_H
+    { "MOV E,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_E, 0 }, // 0x5d MOV_E_L
+    { "MOV E,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_E, OP_CODE_READS_MEMORY }, // 0x5e MOV_E_M
+    { "MOV E,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_E, 0 }, // 0x5f MOV_E_A
+    { "MOV H,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_H, 0 }, // 0x60 MOV_H_B
+    { "MOV H,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_H, 0 }, // 0x61 MOV_H_C
+    { "MOV H,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_H, 0 }, // 0x62 MOV_H_D
+    { "MOV H,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_H, 0 }, // 0x63 MOV_H_E
+    { "MOV H,H", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x64 MOV_H_H
+    { "MOV H,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_H, 0 }, // 0x65 MOV_H_L
+    { "MOV H,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_H, OP_CODE_READS_MEMORY }, // 0x66 MOV_H_M
+    { "MOV H,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_H, 0 }, // 0x67 MOV_H_A
+    { "MOV L,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_L, 0 }, // 0x68 MOV_L_B
+    { "MOV L,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_L, 0 }, // 0x69 MOV_L_C
+    { "MOV L,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_L, 0 }, // 0x6a MOV_L_D
+    { "MOV L,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_L, 0 }, // 0x6b MOV_L_E
+    { "MOV L,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_L, 0 }, // 0x6c MOV_L_H
+    { "MOV L,L", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x6d MOV_L_L
+    { "MOV L,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_L, OP_CODE_READS_MEMORY }, // 0x6e MOV_L_M
+    { "MOV L,A", 1, 5, 5, 0, 0, REGISTER_BIT_A, REGISTER_BIT_L, 0 }, // 0x6f MOV_L_A
+    { "MOV M,B", 1, 7, 7, 0, 0, REGISTER_BIT_B | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x70 MOV_M_B
+    { "MOV M,C", 1, 7, 7, 0, 0, REGISTER_BIT_C | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x71 MOV_M_C
+    { "MOV M,D", 1, 7, 7, 0, 0, REGISTER_BIT_D | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x72 MOV_M_D
+    { "MOV M,E", 1, 7, 7, 0, 0, REGISTER_BIT_E | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x73 MOV_M_E
+    { "MOV M,H", 1, 7, 7, 0, 0, REGISTER_BIT_H | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x74 MOV_M_H
+    { "MOV M,L", 1, 7, 7, 0, 0, REGISTER_BIT_L | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x75 MOV_M_L
+    { "HLT", 1, 7, 7, 0, 0, 0, 0, OP_CODE_HALT }, // 0x76 HLT
+    { "MOV M,A", 1, 7, 7, 0, 0, REGISTER_BIT_A | REGISTER_BITS_HL, 0, OP_CODE_WRITES_MEMORY }, // 0x77 MOV_M_A
+    { "MOV A,B", 1, 5, 5, 0, 0, REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0x78 MOV_A_B
+    { "MOV A,C", 1, 5, 5, 0, 0, REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0x79 MOV_A_C
+    { "MOV A,D", 1, 5, 5, 0, 0, REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0x7a MOV_A_D
+    { "MOV A,E", 1, 5, 5, 0, 0, REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0x7b MOV_A_E
+    { "MOV A,H", 1, 5, 5, 0, 0, REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0x7c MOV_A_H
+    { "MOV A,L", 1, 5, 5, 0, 0, REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0x7d MOV_A_L
+    { "MOV A,M", 1, 7, 7, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x7e MOV_A_M
+    { "MOV A,A", 1, 4, 4, 0, 0, 0, 0, 0 }, // 0x7f MOV_A_A
+    { "ADD B", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0x80 ADD_B
+    { "ADD C", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0x81 ADD_C
+    { "ADD D", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0x82 ADD_D
+    { "ADD E", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0x83 ADD_E
+    { "ADD H", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0x84 ADD_H
+    { "ADD L", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0x85 ADD_L
+    { "ADD M", 1, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x86 ADD_M
+    { "ADD A", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x87 ADD_A
+    { "ADC B", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0x88 ADC_B
+    { "ADC C", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0x89 ADC_C
+    { "ADC D", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0x8a ADC_D
+    { "ADC E", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0x8b ADC_E
+    { "ADC H", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0x8c ADC_H
+    { "ADC L", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0x8d ADC_L
+    { "ADC M", 1, 7, 7, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x8e ADC_M
+    { "ADC A", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x8f ADC_A
+    { "SUB B", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0x90 SUB_B
+    { "SUB C", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0x91 SUB_C
+    { "SUB D", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0x92 SUB_D
+    { "SUB E", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0x93 SUB_E
+    { "SUB H", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0x94 SUB_H
+    { "SUB L", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0x95 SUB_L
+    { "SUB M", 1, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x96 SUB_M
+    { "SUB A", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x97 SUB_A
+    { "SBB B", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0x98 SBB_B
+    { "SBB C", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0x99 SBB_C
+    { "SBB D", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0x9a SBB_D
+    { "SBB E", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0x9b SBB_E
+    { "SBB H", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0x9c SBB_H
+    { "SBB L", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0x9d SBB_L
+    { "SBB M", 1, 7, 7, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0x9e SBB_M
+    { "SBB A", 1, 4, 4, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0x9f SBB_A
+    { "ANA B", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0xa0 ANA_B
+    { "ANA C", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0xa1 ANA_C
+    { "ANA D", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0xa2 ANA_D
+    { "ANA E", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0xa3 ANA_E
+    { "ANA H", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0xa4 ANA_H
+    { "ANA L", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0xa5 ANA_L
+    { "ANA M", 1, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0xa6 ANA_M
+    { "ANA A", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xa7 ANA_A
+    { "XRA B", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0xa8 XRA_B
+    { "XRA C", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0xa9 XRA_C
+    { "XRA D", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0xaa XRA_D
+    { "XRA E", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0xab XRA_E
+    { "XRA H", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0xac XRA_H
+    { "XRA L", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0xad XRA_L
+    { "XRA M", 1, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0xae XRA_M
+    { "XRA A", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xaf XRA_A
+    { "ORA B", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_B, REGISTER_BIT_A, 0 }, // 0xb0 ORA_B
+    { "ORA C", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_C, REGISTER_BIT_A, 0 }, // 0xb1 ORA_C
+    { "ORA D", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_D, REGISTER_BIT_A, 0 }, // 0xb2 ORA_D
+    { "ORA E", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_E, REGISTER_BIT_A, 0 }, // 0xb3 ORA_E
+    { "ORA H", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_H, REGISTER_BIT_A, 0 }, // 0xb4 ORA_H
+    { "ORA L", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BIT_L, REGISTER_BIT_A, 0 }, // 0xb5 ORA_L
+    { "ORA M", 1, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A | REGISTER_BITS_HL, REGISTER_BIT_A, OP_CODE_READS_MEMORY }, // 0xb6 ORA_M
+    { "ORA A", 1, 4, 4, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xb7 ORA_A
+    { "CMP B", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_B, 0, 0 }, // 0xb8 CMP_B
+    { "CMP C", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_C, 0, 0 }, // 0xb9 CMP_C
+    { "CMP D", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_D, 0, 0 }, // 0xba CMP_D
+    { "CMP E", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_E, 0, 0 }, // 0xbb CMP_E
+    { "CMP H", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_H, 0, 0 }, // 0xbc CMP_H
+    { "CMP L", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BIT_L, 0, 0 }, // 0xbd CMP_L
+    { "CMP M", 1, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A | REGISTER_BITS_HL, 0, OP_CODE_READS_MEMORY }, // 0xbe CMP_M
+    { "CMP A", 1, 4, 4, 0, ALU_FLAG_BITS, REGISTER_BIT_A, 0, 0 }, // 0xbf CMP_A
+    { "RNZ", 1, 5, 11, ZERO_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xc0 RNZ
+    { "POP B", 1, 10, 10, 0, 0, REGISTER_BIT_SP, REGISTER_BITS_BC | REGISTER_BIT_SP, OP_CODE_READS_MEMORY }, // 0xc1 POP_B
+    { "JNZ 0x%04x", 3, 10, 10, ZERO_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xc2 JNZ
+    { "JMP 0x%04x", 3, 10, 10, 0, 0, 0, 0, OP_CODE_JUMP }, // 0xc3 JMP
+    { "CNZ 0x%04x", 3, 11, 17, ZERO_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xc4 CNZ
+    { "PUSH B", 1, 11, 11, 0, 0, REGISTER_BITS_BC | REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_WRITES_MEMORY }, // 0xc5 PUSH_B
+    { "ADI 0x%02x", 2, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xc6 ADI
+    { "RST 0", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xc7 RST_0
+    { "RZ", 1, 5, 11, ZERO_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xc8 RZ
+    { "RET", 1, 10, 10, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_READS_MEMORY }, // 0xc9 RET
+    { "JZ 0x%04x", 3, 10, 10, ZERO_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xca JZ
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0xcb -
+    { "CZ 0x%04x", 3, 11, 17, ZERO_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xcc CZ
+    { "CALL 0x%04x", 3, 17, 17, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_WRITES_MEMORY }, // 0xcd CALL
+    { "ACI 0x%02x", 2, 7, 7, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xce ACI
+    { "RST 1", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xcf RST_1
+    { "RNC", 1, 5, 11, CARRY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xd0 RNC
+    { "POP D", 1, 10, 10, 0, 0, REGISTER_BIT_SP, REGISTER_BITS_DE | REGISTER_BIT_SP, OP_CODE_READS_MEMORY }, // 0xd1 POP_D
+    { "JNC 0x%04x", 3, 10, 10, CARRY_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xd2 JNC
+    { "OUT 0x%02x", 2, 10, 10, 0, 0, REGISTER_BIT_A, 0, OP_CODE_IO }, // 0xd3 OUT
+    { "CNC 0x%04x", 3, 11, 17, CARRY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xd4 CNC
+    { "PUSH D", 1, 11, 11, 0, 0, REGISTER_BITS_DE | REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_WRITES_MEMORY }, // 0xd5 PUSH_D
+    { "SUI 0x%02x", 2, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xd6 SUI
+    { "RST 2", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xd7 RST_2
+    { "RC", 1, 5, 11, CARRY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xd8 RC
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0xd9 -
+    { "JC 0x%04x", 3, 10, 10, CARRY_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xda JC
+    { "IN 0x%02x", 2, 10, 10, 0, 0, 0, REGISTER_BIT_A, OP_CODE_IO }, // 0xdb IN
+    { "CC 0x%04x", 3, 11, 17, CARRY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xdc CC
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0xdd -
+    { "SBI 0x%02x", 2, 7, 7, CARRY_BIT, ALU_FLAG_BITS, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xde SBI
+    { "RST 3", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xdf RST_3
+    { "RPO", 1, 5, 11, PARITY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xe0 RPO
+    { "POP H", 1, 10, 10, 0, 0, REGISTER_BIT_SP, REGISTER_BITS_HL | REGISTER_BIT_SP, OP_CODE_READS_MEMORY }, // 0xe1 POP_H
+    { "JPO 0x%04x", 3, 10, 10, PARITY_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xe2 JPO
+    { "XTHL", 1, 18, 18, 0, 0, REGISTER_BITS_HL | REGISTER_BIT_SP, REGISTER_BITS_HL, OP_CODE_READS_MEMORY | OP_CODE_WRITES_MEMORY }, // 0xe3 XTHL
+    { "CPO 0x%04x", 3, 11, 17, PARITY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xe4 CPO
+    { "PUSH H", 1, 11, 11, 0, 0, REGISTER_BITS_HL | REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_WRITES_MEMORY }, // 0xe5 PUSH_H
+    { "ANI 0x%02x", 2, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xe6 ANI
+    { "RST 4", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xe7 RST_4
+    { "RPE", 1, 5, 11, PARITY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xe8 RPE
+    { "PCHL", 1, 5, 5, 0, 0, REGISTER_BITS_HL, 0, OP_CODE_JUMP }, // 0xe9 PCHL
+    { "JPE 0x%04x", 3, 10, 10, PARITY_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xea JPE
+    { "XCHG", 1, 4, 4, 0, 0, REGISTER_BITS_DE | REGISTER_BITS_HL, REGISTER_BITS_DE | REGISTER_BITS_HL, 0 }, // 0xeb XCHG
+    { "CPE 0x%04x", 3, 11, 17, PARITY_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xec CPE
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0xed -
+    { "XRI 0x%02x", 2, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xee XRI
+    { "RST 5", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xef RST_5
+    { "RP", 1, 5, 11, SIGN_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xf0 RP
+    { "POP PSW", 1, 10, 10, 0, ALU_FLAG_BITS, REGISTER_BIT_SP, REGISTER_BIT_A | REGISTER_BIT_SP, OP_CODE_READS_MEMORY }, // 0xf1 POP_PSW
+    { "JP 0x%04x", 3, 10, 10, SIGN_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xf2 JP
+    { "DI", 1, 4, 4, 0, 0, 0, 0, OP_CODE_INTERRUPTS }, // 0xf3 DI
+    { "CP 0x%04x", 3, 11, 17, SIGN_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xf4 CP
+    { "PUSH PSW", 1, 11, 11, ALU_FLAG_BITS, 0, REGISTER_BIT_A | REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_WRITES_MEMORY }, // 0xf5 PUSH_PSW
+    { "ORI 0x%02x", 2, 7, 7, 0, SZP_BITS | CARRY_BIT, REGISTER_BIT_A, REGISTER_BIT_A, 0 }, // 0xf6 ORI
+    { "RST 6", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xf7 RST_6
+    { "RM", 1, 5, 11, SIGN_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_RETURN | OP_CODE_CONDITIONAL | OP_CODE_READS_MEMORY }, // 0xf8 RM
+    { "SPHL", 1, 5, 5, 0, 0, REGISTER_BITS_HL, REGISTER_BIT_SP, 0 }, // 0xf9 SPHL
+    { "JM 0x%04x", 3, 10, 10, SIGN_BIT, 0, 0, 0, OP_CODE_JUMP | OP_CODE_CONDITIONAL }, // 0xfa JM
+    { "EI", 1, 4, 4, 0, 0, 0, 0, OP_CODE_INTERRUPTS }, // 0xfb EI
+    { "CM 0x%04x", 3, 11, 17, SIGN_BIT, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_CONDITIONAL | OP_CODE_WRITES_MEMORY }, // 0xfc CM
+    { "-", 1, 0, 0, 0, 0, 0, 0, OP_CODE_UNDEFINED | OP_CODE_TRAP }, // 0xfd -
+    { "CPI 0x%02x", 2, 7, 7, 0, ALU_FLAG_BITS, REGISTER_BIT_A, 0, 0 }, // 0xfe CPI
+    { "RST 7", 1, 11, 11, 0, 0, REGISTER_BIT_SP, REGISTER_BIT_SP, OP_CODE_CALL | OP_CODE_RESTART | OP_CODE_TRAP | OP_CODE_WRITES_MEMORY }, // 0xff RST_7
+  };
+};
+
+constexpr const OpCodeInfo &opCodeInfo(uint8_t opCode)
+{
+  return OpCodeTable::entries[opCode];
+}
+
+/*
+ * The length and cycles the interpreters charge before running a handler.
+ * Traps are charged nothing and leave the program counter where it is.
+ */
+constexpr uint8_t interpreterLength(uint8_t opCode)
+{
+  return (opCodeInfo(opCode).attributes & OP_CODE_TRAP) ? 0 : opCodeInfo(opCode).length;
+}
+
+constexpr uint8_t interpreterCycles(uint8_t opCode)
+{
+  return (opCodeInfo(opCode).attributes & OP_CODE_TRAP) ? 0 : opCodeInfo(opCode).cycles;
+}
+
+constexpr uint8_t branchTakenCycles(uint8_t opCode)
+{
+  return opCodeInfo(opCode).takenCycles - opCodeInfo(opCode).cycles;
+}
+
+uint8_t disassembleInstruction(const uint8_t *code, char *text, size_t size);
+
+#endif
@@ -0,0 +1,267 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "control_flow.h"
+#include "cpu.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+
+#define MAX_ROM_SIZE 65536
+
+using namespace std;
+
+/*
+ * Statically recompiles a ROM image into C++ with one function per basic
+ * block, for the aot core. Usage:
+ *
+ *   recompile <rom> <symbol> [entry ...]
+ *
+ * The generated translation unit defines "const StaticProgram <symbol>" and
+ * is written to standard output. Disassembly starts at the given entry
+ * addresses, or at the reset and RST vectors when there are none, and
+ * follows every jump, call and fall-through it can see, and the jump tables
+ * in front of PCHL. Other indirect targets and code outside the image are
+ * left to the interpreter.
+ */
+
+const char *registerNames[8] = { "registerB", "registerC", "registerD", "registerE", "registerH", "registerL", NULL, "registerA" };
+const char *registerPairNames[3] = { "REGISTER_PAIR_B", "REGISTER_PAIR_D", "REGISTER_PAIR_H" };
+
+struct RomImage
+{
+  vector<uint8_t> bytes;
+
+  bool fits(uint32_t address)
+  {
+    return address < bytes.size() && address + opCodeInfo(bytes[address]).length <= bytes.size();
+  }
+
+  // The immediate operand, or 0 for an instruction without one.
+  uint16_t operand(uint32_t address)
+  {
+    uint8_t length = opCodeInfo(bytes[address]).length;
+
+    return (length > 1 ? bytes[address + 1] : 0) | (length > 2 ? bytes[address + 2] << 8 : 0);
+  }
+};
+
+/*
+ * Gives the C++ statement for an instruction that only moves data, matching
+ * the set the JIT compiles inline. Returns false if the instruction has to
+ * call its interpreter handler instead.
+ */
+bool inlineStatement(RomImage &rom, uint32_t address, string *statement)
+{
+  uint8_t opCode = rom.bytes[address];
+  uint16_t operand = rom.operand(address);
+  uint8_t destination = opCode >> 3 & 7;
+  uint8_t source = opCode & 7;
+  uint8_t pair = opCode >> 4 & 3;
+  char text[160] = "";
+
+  if (opCode == NOP)
+  {
+    statement->clear();
+    return true;
+  }
+  else if (opCode >= MOV_B_B && opCode <= MOV_A_A && opCode != HLT && destination != REGISTER_M)
+  {
+    if (source == REGISTER_M)
+    {
+      snprintf(text, sizeof(text), "cpu->%s = cpu->memory[cpu->registerPairs[REGISTER_PAIR_H]];", registerNames[destination]);
+    }
+    else
+    {
+      snprintf(text, sizeof(text), "cpu->%s = cpu->%s;", registerNames[destination], registerNames[source]);
+    }
+  }
+  else if ((opCode & 0xc7) == MVI_B && destination != REGISTER_M)
+  {
+    snprintf(text, sizeof(text), "cpu->%s = 0x%02x;", registerNames[destination], operand & 0xff);
+  }
+  else if ((opCode & 0xcf) == LXI_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "cpu->registerPairs[%s] = 0x%04x;", registerPairNames[pair], operand);
+  }
+  else if ((opCode & 0xcf) == INX_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "cpu->registerPairs[%s]++;", registerPairNames[pair]);
+  }
+  else if ((opCode & 0xcf) == DCX_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "cpu->registerPairs[%s]--;", registerPairNames[pair]);
+  }
+  else if (opCode == XCHG)
+  {
+    snprintf(text, sizeof(text), "swap(cpu->registerPairs[REGISTER_PAIR_D], cpu->registerPairs[REGISTER_PAIR_H]);");
+  }
+  else if (opCode == LDX_B || opCode == LDX_D)
+  {
+    snprintf(text, sizeof(text), "cpu->registerA = cpu->memory[cpu->registerPairs[%s]];", registerPairNames[pair]);
+  }
+  else if (opCode == LDA)
+  {
+    snprintf(text, sizeof(text), "cpu->registerA = cpu->memory[0x%04x];", operand);
+  }
+  else if (opCode == LXLD && operand != 0xffff)
+  {
+    snprintf(text, sizeof(text), "cpu->registerPairs[REGISTER_PAIR_H] = cpu->memory[0x%04x] << 8 | cpu->memory[0x%04x];", operand + 1, operand);
+  }
+  else if (opCode == CMA)
+  {
+    snprintf(text, sizeof(text), "cpu->registerA = ~cpu->registerA;");
+  }
+
+  *statement = text;
+  return !statement->empty();
+}
+
+/*
+ * Emits the block starting at a leader. It runs until an instruction that
+ * ends a block, the next leader or the edge of the image, and never spans
+ * more than two pages, so the aot core only has to check two pages for
+ * stores. Returns the length of the block in bytes.
+ */
+uint32_t emitBlock(RomImage &rom, uint32_t start, const set<uint32_t> &leaders)
+{
+  uint32_t address = start;
+  uint32_t pendingCycles = 0;
+  bool flushed = false;
+
+  printf("static void block%04x(CPU *cpu)\n{\n", start);
+
+  do
+  {
+    uint8_t opCode = rom.bytes[address];
+    const OpCodeInfo &info = opCodeInfo(opCode);
+    string statement;
+    char text[32];
+
+    disassembleInstruction(&rom.bytes[address], text, sizeof(text));
+    pendingCycles += interpreterCycles(opCode);
+    flushed = !inlineStatement(rom, address, &statement);
+
+    if (!flushed)
+    {
+      printf("  %s%s// %s\n", statement.c_str(), statement.empty() ? "" : " ", text);
+    }
+    else
+    {
+      printf("  cpu->programCounter = 0x%04x;\n", (uint16_t)(address + interpreterLength(opCode)));
+
+      if (pendingCycles > 0)
+      {
+        printf("  StaticCode::addCycles(cpu, %u);\n", pendingCycles);
+      }
+
+      printf("  StaticCode::execute(cpu, 0x%02x, 0x%04x); // %s\n", opCode, rom.operand(address), text);
+      pendingCycles = 0;
+
+      // A store can retire the block, and I/O can fault, which ends it too.
+      if ((info.attributes & (OP_CODE_WRITES_MEMORY | OP_CODE_IO)) && !(info.attributes & OP_CODE_ENDS_BLOCK))
+      {
+        printf("\n  if (StaticCode::codeInvalidated(cpu))\n  {\n    return;\n  }\n\n");
+      }
+    }
+
+    address += info.length;
+
+    if (info.attributes & OP_CODE_ENDS_BLOCK)
+    {
+      break;
+    }
+  }
+  while (rom.fits(address) && !leaders.count(address) && address - start + 3 < BLOCK_PAGE_SIZE);
+
+  if (!flushed)
+  {
+    printf("  cpu->programCounter = 0x%04x;\n", address);
+
+    if (pendingCycles > 0)
+    {
+      printf("  StaticCode::addCycles(cpu, %u);\n", pendingCycles);
+    }
+  }
+
+  printf("}\n\n");
+  return address - start;
+}
+
+void emitProgram(RomImage &rom, const set<uint32_t> &leaders, string symbol)
+{
+  map<uint32_t, uint32_t> lengths;
+
+  printf("// Generated by recompile from a %u byte ROM image. Do not edit.\n\n", (unsigned)rom.bytes.size());
+  printf("#include <utility>\n\n#include \"static_code.h\"\n\n");
+
+  for (set<uint32_t>::const_iterator it = leaders.begin(); it != leaders.end(); ++it)
+  {
+    if (rom.fits(*it))
+    {
+      lengths[*it] = emitBlock(rom, *it, leaders);
+    }
+  }
+
+  printf("static const StaticBlock blocks[%u] = {\n", (unsigned)lengths.size());
+
+  for (map<uint32_t, uint32_t>::const_iterator it = lengths.begin(); it != lengths.end(); ++it)
+  {
+    printf("  { 0x%04x, %u, block%04x },\n", it->first, it->second, it->first);
+  }
+
+  printf("};\n\nstatic const uint8_t image[%u] = {", (unsigned)rom.bytes.size());
+
+  for (size_t i = 0; i < rom.bytes.size(); i++)
+  {
+    printf("%s0x%02x,", i % 12 ? " " : "\n  ", rom.bytes[i]);
+  }
+
+  printf("\n};\n\nextern const StaticProgram %s;\n", symbol.c_str());
+  printf("const StaticProgram %s = { image, %u, blocks, %u };\n", symbol.c_str(), (unsigned)rom.bytes.size(), (unsigned)lengths.size());
+}
+
+int main(int argc, char *argv[])
+{
+  RomImage rom;
+  vector<uint32_t> entries;
+
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: recompile <rom> <symbol> [entry ...]\n");
+    return 1;
+  }
+
+  ifstream input(argv[1], ios::in | ios::binary);
+
+  rom.bytes.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+
+  if (!input || rom.bytes.empty() || rom.bytes.size() > MAX_ROM_SIZE)
+  {
+    fprintf(stderr, "Failed to load %s\n", argv[1]);
+    return 1;
+  }
+
+  for (int i = 3; i < argc; i++)
+  {
+    entries.push_back(strtoul(argv[i], NULL, 0));
+  }
+
+  if (argc == 3)
+  {
+    entries = ControlFlowGraph::resetEntries();
+  }
+
+  ControlFlowGraph graph(rom.bytes.data(), rom.bytes.size());
+
+  graph.explore(entries);
+  emitProgram(rom, graph.leaders, argv[2]);
+  return 0;
+}
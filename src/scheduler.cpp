@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "scheduler.h"
+
+using namespace std;
+
+// std::push_heap keeps the largest element first, so the later event
+// compares as less.
+static bool laterEvent(const ScheduledEvent &a, const ScheduledEvent &b)
+{
+  return a.cycle != b.cycle ? a.cycle > b.cycle : a.sequence > b.sequence;
+}
+
+Scheduler::Scheduler() : nextSequence(0)
+{
+}
+
+void Scheduler::schedule(uint64_t cycle, EventHandler *handler, uint8_t event)
+{
+  ScheduledEvent scheduled = { cycle, nextSequence++, handler, event };
+
+  events.push_back(scheduled);
+  push_heap(events.begin(), events.end(), laterEvent);
+}
+
+void Scheduler::cancel(EventHandler *handler)
+{
+  vector<ScheduledEvent> kept;
+
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    if (events[i].handler != handler)
+    {
+      kept.push_back(events[i]);
+    }
+  }
+
+  events.swap(kept);
+  make_heap(events.begin(), events.end(), laterEvent);
+}
+
+bool Scheduler::popDueEvent(uint64_t now, ScheduledEvent *event)
+{
+  if (events.empty() || events.front().cycle > now)
+  {
+    return false;
+  }
+
+  *event = events.front();
+  pop_heap(events.begin(), events.end(), laterEvent);
+  events.pop_back();
+  return true;
+}
+
+void Scheduler::clear()
+{
+  events.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "event_handler.h"
+
+using namespace std;
+
+#define NO_EVENT UINT64_MAX
+
+struct ScheduledEvent
+{
+  uint64_t cycle;
+  uint64_t sequence;
+  EventHandler *handler;
+  uint8_t event;
+};
+
+/*
+ * Pending events in a min-heap keyed on their cycle. Events due on the same
+ * cycle come out in the order they were scheduled.
+ */
+class Scheduler
+{
+  public:
+    Scheduler();
+    void schedule(uint64_t cycle, EventHandler *handler, uint8_t event);
+    void cancel(EventHandler *handler);
+    uint64_t nextEventCycle();
+    bool popDueEvent(uint64_t now, ScheduledEvent *event);
+    void clear();
+
+  private:
+    vector<ScheduledEvent> events;
+    uint64_t nextSequence;
+};
+
+inline uint64_t Scheduler::nextEventCycle()
+{
+  return events.empty() ? NO_EVENT : events.front().cycle;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SINGLE_PRODUCER_QUEUE_H
+#define SINGLE_PRODUCER_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * A fixed-size queue between exactly one producer thread and one consumer
+ * thread. Neither side ever waits on the other: push() fails when the queue
+ * is full and pop() when it is empty.
+ */
+template <class T, size_t Size> class SingleProducerQueue
+{
+  public:
+    SingleProducerQueue() : head(0), tail(0) {}
+    bool push(T item);
+    bool pop(T *item);
+
+  private:
+    T items[Size];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+template <class T, size_t Size> bool SingleProducerQueue<T, Size>::push(T item)
+{
+  size_t position = tail.load(std::memory_order_relaxed);
+
+  if (position - head.load(std::memory_order_acquire) == Size)
+  {
+    return false;
+  }
+
+  items[position % Size] = item;
+  tail.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <class T, size_t Size> bool SingleProducerQueue<T, Size>::pop(T *item)
+{
+  size_t position = head.load(std::memory_order_relaxed);
+
+  if (position == tail.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  *item = items[position % Size];
+  head.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+#endif
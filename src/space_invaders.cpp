@@ -1,3 +1,4 @@
+#include "op_codes.h"
 #include "space_invaders.h"
 
 using namespace std;
@@ -6,40 +7,15 @@ SpaceInvaders::SpaceInvaders() : registerX(0), shiftOffset(0), inputRegister(0x8
 {
 }
 
-uint8_t SpaceInvaders::inputPortHandler(uint8_t address)
+void SpaceInvaders::startScreenInterrupts(CPU *cpu)
 {
-  switch (address)
-  {
-    case 0:
-      return 1;
-      break;
-    case 1:
-      return inputRegister;
-      break;
-    case 2:
-      return 0;
-      break;
-    case 3:
-      return registerX >> (8 - shiftOffset) & 0xff;
-      break;
-  }
-
-  return 0;
+  cpu->scheduleEvent(cpu->elapsedCycles() + CYCLES_PER_SCREEN_INTERRUPT, this, RST_1);
 }
 
-uint8_t SpaceInvaders::outputPortHandler(uint8_t address, uint8_t value)
+void SpaceInvaders::handleEvent(CPU *cpu, uint8_t event, uint64_t cycle)
 {
-  switch (address)
-  {
-    case 2:
-      shiftOffset = value & 0x7;
-      break;
-    case 4:
-      registerX = registerX >> 8 | value << 8;
-      break;
-  }
-
-  return 0;
+  cpu->handleInterrupt(event);
+  cpu->scheduleEvent(cycle + CYCLES_PER_SCREEN_INTERRUPT, this, event == RST_1 ? RST_2 : RST_1);
 }
 
 void SpaceInvaders::buttonPressed(uint8_t button)
@@ -2,6 +2,7 @@
 #define SPACE_INVADERS_H
 
 #include "cpu.h"
+#include "event_handler.h"
 #include "port_handler.h"
 
 #define BUTTON_COIN 1
@@ -10,12 +11,18 @@
 #define BUTTON_LEFT 32
 #define BUTTON_RIGHT 64
 
-class SpaceInvaders : public PortHandler
+// The video hardware interrupts twice a frame at 60Hz on a 2MHz CPU: RST 1
+// in the middle of the screen and RST 2 at vblank.
+#define CYCLES_PER_SCREEN_INTERRUPT 16666
+
+class SpaceInvaders : public PortHandler, public EventHandler
 {
   public:
     SpaceInvaders();
     virtual uint8_t outputPortHandler(uint8_t address, uint8_t value);
     virtual uint8_t inputPortHandler(uint8_t address);
+    virtual void handleEvent(CPU *cpu, uint8_t event, uint64_t cycle);
+    void startScreenInterrupts(CPU *cpu);
     uint16_t registerX;
     uint8_t shiftOffset;
     uint8_t inputRegister;
@@ -23,4 +30,42 @@ class SpaceInvaders : public PortHandler
     void buttonReleased(uint8_t button);
 };
 
+// The port handlers are inline so a core specialised on SpaceInvaders can
+// inline the shift register.
+inline uint8_t SpaceInvaders::inputPortHandler(uint8_t address)
+{
+  switch (address)
+  {
+    case 0:
+      return 1;
+      break;
+    case 1:
+      return inputRegister;
+      break;
+    case 2:
+      return 0;
+      break;
+    case 3:
+      return registerX >> (8 - shiftOffset) & 0xff;
+      break;
+  }
+
+  return 0;
+}
+
+inline uint8_t SpaceInvaders::outputPortHandler(uint8_t address, uint8_t value)
+{
+  switch (address)
+  {
+    case 2:
+      shiftOffset = value & 0x7;
+      break;
+    case 4:
+      registerX = registerX >> 8 | value << 8;
+      break;
+  }
+
+  return 0;
+}
+
 #endif
@@ -0,0 +1,75 @@
+#include <cstring>
+
+#include "block_cache.h"
+#include "static_code.h"
+
+/*
+ * Gives the aot core the blocks the recompiler produced for a ROM image. They
+ * are used whenever the loaded program starts with that image; any other
+ * program runs on the block core as before.
+ */
+void CPU::setStaticProgram(const StaticProgram *program)
+{
+  staticProgram = program;
+  staticBlocks.assign(memory.size(), NULL);
+
+  for (size_t i = 0; i < program->blockCount; i++)
+  {
+    staticBlocks[program->blocks[i].address] = &program->blocks[i];
+  }
+
+  activateStaticCode();
+}
+
+bool CPU::runsStaticCode()
+{
+  return staticCodeActive;
+}
+
+/*
+ * Checks the program against the image the static code was compiled from and
+ * marks the pages it covers as holding code, so a store into one of them
+ * retires its static blocks just as it retires decoded ones.
+ */
+void CPU::activateStaticCode()
+{
+  staticCodeActive = staticProgram && programLength >= staticProgram->imageSize &&
+    memcmp(memory.data(), staticProgram->image, staticProgram->imageSize) == 0;
+
+  if (!staticCodeActive)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < staticProgram->blockCount; i++)
+  {
+    const StaticBlock &block = staticProgram->blocks[i];
+
+    blockCache.markCode(block.address >> 8);
+    blockCache.markCode((block.address + block.length - 1) >> 8);
+  }
+}
+
+/*
+ * Runs the static block at the program counter, if there is one and the
+ * program has not written to its pages. Otherwise the caller falls back to a
+ * decoded block, as it does for code in RAM and the targets of PCHL that the
+ * recompiler could not see.
+ */
+bool CPU::runStaticBlock()
+{
+  if (!staticCodeActive)
+  {
+    return false;
+  }
+
+  const StaticBlock *block = staticBlocks[programCounter];
+
+  if (!block || blockCache.pageWritten(block->address >> 8) || blockCache.pageWritten((block->address + block->length - 1) >> 8))
+  {
+    return false;
+  }
+
+  block->run(this);
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef STATIC_CODE_H
+#define STATIC_CODE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu.h"
+
+typedef void (*StaticBlockFunction)(CPU *cpu);
+
+/*
+ * One basic block compiled ahead of time by the recompiler, starting at
+ * address and spanning length bytes of the ROM it was compiled from.
+ */
+struct StaticBlock
+{
+  uint16_t address;
+  uint16_t length;
+  StaticBlockFunction run;
+};
+
+/*
+ * The output of the recompiler for one ROM image. The CPU only runs the
+ * blocks while its memory starts with the same image.
+ */
+struct StaticProgram
+{
+  const uint8_t *image;
+  uint32_t imageSize;
+  const StaticBlock *blocks;
+  size_t blockCount;
+};
+
+#ifdef HAS_STATIC_INVADERS
+extern const StaticProgram invadersStaticProgram;
+#endif
+
+/*
+ * What recompiled code needs from the CPU beyond its public registers and
+ * memory. Instructions that are not compiled inline call their interpreter
+ * handler through execute(), with the program counter and cycles already
+ * brought up to date, as the JIT does.
+ */
+class StaticCode
+{
+  public:
+    static void execute(CPU *cpu, uint8_t opCode, uint16_t operand);
+    static void addCycles(CPU *cpu, uint32_t cycles);
+    static bool codeInvalidated(CPU *cpu);
+};
+
+inline void StaticCode::execute(CPU *cpu, uint8_t opCode, uint16_t operand)
+{
+  (cpu->*CPU::instructionTable[opCode].handler)(opCode, operand);
+}
+
+inline void StaticCode::addCycles(CPU *cpu, uint32_t cycles)
+{
+  cpu->cycles += cycles;
+}
+
+inline bool StaticCode::codeInvalidated(CPU *cpu)
+{
+  return cpu->blockCache.codeInvalidated;
+}
+
+#endif
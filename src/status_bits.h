@@ -7,6 +7,9 @@
 #define ZERO_BIT 64
 #define SIGN_BIT 128
 
+#define SZP_BITS (SIGN_BIT | ZERO_BIT | PARITY_BIT)
+#define ALU_FLAG_BITS (SZP_BITS | AUXILIARY_CARRY_BIT | CARRY_BIT)
+
 #define AUXILIARY_CARRY_SHIFT 3
 #define CARRY_SHIFT 7
 
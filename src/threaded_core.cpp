@@ -0,0 +1,678 @@
+#include "threaded_core.h"
+
+#ifdef HAS_THREADED_CORE
+
+#include "bit_ops.h"
+#include "cpu.h"
+#include "op_code_info.h"
+#include "space_invaders.h"
+#include "status_bits.h"
+
+/*
+ * Every handler ends with its own copy of DISPATCH, so each op code gets an
+ * indirect jump the branch predictor can learn on its own.
+ */
+#define FETCH_AND_DISPATCH() \
+  if (halt) \
+  { \
+    return; \
+  } \
+  enterPendingInterrupt(); \
+  opCode = memory[programCounter]; \
+  operand = memory[(uint16_t)(programCounter + 2)] << 8 | memory[(uint16_t)(programCounter + 1)]; \
+  programCounter += instructionTable[opCode].length; \
+  cycles += instructionTable[opCode].cycles; \
+  goto *labels[opCode]
+
+#define FOLLOW_JUMPS (!(Features & CORE_FEATURE_TEST_HOOKS) || followJumps)
+
+#define DISPATCH() \
+  if (!continueProgram<Features>()) \
+  { \
+    return; \
+  } \
+  FETCH_AND_DISPATCH()
+
+template <class Ports, unsigned Features> void CPU::runThreaded()
+{
+  static void *const labels[256] = {
+    &&noOperation,                 // 0x00 NOP
+    &&loadRegisterPairImmediate,   // 0x01 LXI_B
+    &&storeAccumulatorIndirect,    // 0x02 STAX_B
+    &&incrementRegisterPair,       // 0x03 INX_B
+    &&incrementRegister,           // 0x04 INR_B
+    &&decrementRegister,           // 0x05 DCR_B
+    &&moveImmediate,               // 0x06 MVI_B
+    &&rotateLeft,                  // 0x07 RLC
+    &&quit,                        // 0x08 QUIT
+    &&addRegisterPairToH,          // 0x09 DAD_B
+    &&loadAccumulatorIndirect,     // 0x0a LDX_B
+    &&decrementRegisterPair,       // 0x0b DCX_B
+    &&incrementRegister,           // 0x0c INR_C
+    &&decrementRegister,           // 0x0d DCR_C
+    &&moveImmediate,               // 0x0e MVI_C
+    &&rotateRight,                 // 0x0f RRC
+    &&unhandledOpCode,             // 0x10 -
+    &&loadRegisterPairImmediate,   // 0x11 LXI_D
+    &&storeAccumulatorIndirect,    // 0x12 STAX_D
+    &&incrementRegisterPair,       // 0x13 INX_D
+    &&incrementRegister,           // 0x14 INR_D
+    &&decrementRegister,           // 0x15 DCR_D
+    &&moveImmediate,               // 0x16 MVI_D
+    &&rotateLeftThroughCarry,      // 0x17 RAL
+    &&unhandledOpCode,             // 0x18 -
+    &&addRegisterPairToH,          // 0x19 DAD_D
+    &&loadAccumulatorIndirect,     // 0x1a LDX_D
+    &&decrementRegisterPair,       // 0x1b DCX_D
+    &&incrementRegister,           // 0x1c INR_E
+    &&decrementRegister,           // 0x1d DCR_E
+    &&moveImmediate,               // 0x1e MVI_E
+    &&rotateRightThroughCarry,     // 0x1f RAR
+    &&unhandledOpCode,             // 0x20 -
+    &&loadRegisterPairImmediate,   // 0x21 LXI_H
+    &&storeHLDirect,               // 0x22 SHLD
+    &&incrementRegisterPair,       // 0x23 INX_H
+    &&incrementRegister,           // 0x24 INR_H
+    &&decrementRegister,           // 0x25 DCR_H
+    &&moveImmediate,               // 0x26 MVI_H
+    &&decimalAdjustAccumulator,    // 0x27 DAA
+    &&unhandledOpCode,             // 0x28 -
+    &&addRegisterPairToH,          // 0x29 DAD_H
+    &&loadHLDirect,                // 0x2a LXLD
+    &&decrementRegisterPair,       // 0x2b DCX_H
+    &&incrementRegister,           // 0x2c INR_L
+    &&decrementRegister,           // 0x2d DCR_L
+    &&moveImmediate,               // 0x2e MVI_L
+    &&complementAccumulator,       // 0x2f CMA
+    &&unhandledOpCode,             // 0x30 -
+    &&loadStackPointerImmediate,   // 0x31 LXI_SP
+    &&storeAccumulatorDirect,      // 0x32 STA
+    &&incrementStackPointer,       // 0x33 INX_SP
+    &&incrementMemory,             // 0x34 INR_M
+    &&decrementMemory,             // 0x35 DCR_M
+    &&moveImmediateToMemory,       // 0x36 MVI_M
+    &&setCarry,                    // 0x37 STC
+    &&unhandledOpCode,             // 0x38 -
+    &&addStackPointerToH,          // 0x39 DAD_SP
+    &&loadAccumulatorDirect,       // 0x3a LDA
+    &&decrementStackPointer,       // 0x3b DCX_SP
+    &&incrementRegister,           // 0x3c INR_A
+    &&decrementRegister,           // 0x3d DCR_A
+    &&moveImmediate,               // 0x3e MVI_A
+    &&complementCarry,             // 0x3f CMC
+    &&noOperation,                 // 0x40 MOV_B_B
+    &&moveRegisterToRegister,      // 0x41 MOV_B_C
+    &&moveRegisterToRegister,      // 0x42 MOV_B_D
+    &&moveRegisterToRegister,      // 0x43 MOV_B_E
+    &&moveRegisterToRegister,      // 0x44 MOV_B_H
+    &&moveRegisterToRegister,      // 0x45 MOV_B_L
+    &&moveMemoryToRegister,        // 0x46 MOV_B_M
+    &&moveRegisterToRegister,      // 0x47 MOV_B_A
+    &&moveRegisterToRegister,      // 0x48 MOV_C_B
+    &&noOperation,                 // 0x49 MOV_C_C
+    &&moveRegisterToRegister,      // 0x4a MOV_C_D
+    &&moveRegisterToRegister,      // 0x4b MOV_C_E
+    &&moveRegisterToRegister,      // 0x4c MOV_C_H
+    &&moveRegisterToRegister,      // 0x4d MOV_C_L
+    &&moveMemoryToRegister,        // 0x4e MOV_C_M
+    &&moveRegisterToRegister,      // 0x4f MOV_C_A
+    &&moveRegisterToRegister,      // 0x50 MOV_D_B
+    &&moveRegisterToRegister,      // 0x51 MOV_D_C
+    &&noOperation,                 // 0x52 MOV_D_D
+    &&moveRegisterToRegister,      // 0x53 MOV_D_E
+    &&moveRegisterToRegister,      // 0x54 MOV_D_H
+    &&moveRegisterToRegister,      // 0x55 MOV_D_L
+    &&moveMemoryToRegister,        // 0x56 MOV_D_M
+    &&moveRegisterToRegister,      // 0x57 MOV_D_A
+    &&moveRegisterToRegister,      // 0x58 MOV_E_B
+    &&moveRegisterToRegister,      // 0x59 MOV_E_C
+    &&moveRegisterToRegister,      // 0x5a MOV_E_D
+    &&noOperation,                 // 0x5b MOV_E_E
+    &&moveRegisterToRegister,      // 0x5c MOV_E_H
+    &&moveRegisterToRegister,      // 0x5d MOV_E_L
+    &&moveMemoryToRegister,        // 0x5e MOV_E_M
+    &&moveRegisterToRegister,      // 0x5f MOV_E_A
+    &&moveRegisterToRegister,      // 0x60 MOV_H_B
+    &&moveRegisterToRegister,      // 0x61 MOV_H_C
+    &&moveRegisterToRegister,      // 0x62 MOV_H_D
+    &&moveRegisterToRegister,      // 0x63 MOV_H_E
+    &&noOperation,                 // 0x64 MOV_H_H
+    &&moveRegisterToRegister,      // 0x65 MOV_H_L
+    &&moveMemoryToRegister,        // 0x66 MOV_H_M
+    &&moveRegisterToRegister,      // 0x67 MOV_H_A
+    &&moveRegisterToRegister,      // 0x68 MOV_L_B
+    &&moveRegisterToRegister,      // 0x69 MOV_L_C
+    &&moveRegisterToRegister,      // 0x6a MOV_L_D
+    &&moveRegisterToRegister,      // 0x6b MOV_L_E
+    &&moveRegisterToRegister,      // 0x6c MOV_L_H
+    &&noOperation,                 // 0x6d MOV_L_L
+    &&moveMemoryToRegister,        // 0x6e MOV_L_M
+    &&moveRegisterToRegister,      // 0x6f MOV_L_A
+    &&moveRegisterToMemory,        // 0x70 MOV_M_B
+    &&moveRegisterToMemory,        // 0x71 MOV_M_C
+    &&moveRegisterToMemory,        // 0x72 MOV_M_D
+    &&moveRegisterToMemory,        // 0x73 MOV_M_E
+    &&moveRegisterToMemory,        // 0x74 MOV_M_H
+    &&moveRegisterToMemory,        // 0x75 MOV_M_L
+    &&halt,                        // 0x76 HLT
+    &&moveRegisterToMemory,        // 0x77 MOV_M_A
+    &&moveRegisterToRegister,      // 0x78 MOV_A_B
+    &&moveRegisterToRegister,      // 0x79 MOV_A_C
+    &&moveRegisterToRegister,      // 0x7a MOV_A_D
+    &&moveRegisterToRegister,      // 0x7b MOV_A_E
+    &&moveRegisterToRegister,      // 0x7c MOV_A_H
+    &&moveRegisterToRegister,      // 0x7d MOV_A_L
+    &&moveMemoryToRegister,        // 0x7e MOV_A_M
+    &&noOperation,                 // 0x7f MOV_A_A
+    &&addRegister,                 // 0x80 ADD_B
+    &&addRegister,                 // 0x81 ADD_C
+    &&addRegister,                 // 0x82 ADD_D
+    &&addRegister,                 // 0x83 ADD_E
+    &&addRegister,                 // 0x84 ADD_H
+    &&addRegister,                 // 0x85 ADD_L
+    &&addMemory,                   // 0x86 ADD_M
+    &&addRegister,                 // 0x87 ADD_A
+    &&addWithCarryRegister,        // 0x88 ADC_B
+    &&addWithCarryRegister,        // 0x89 ADC_C
+    &&addWithCarryRegister,        // 0x8a ADC_D
+    &&addWithCarryRegister,        // 0x8b ADC_E
+    &&addWithCarryRegister,        // 0x8c ADC_H
+    &&addWithCarryRegister,        // 0x8d ADC_L
+    &&addWithCarryMemory,          // 0x8e ADC_M
+    &&addWithCarryRegister,        // 0x8f ADC_A
+    &&subtractRegister,            // 0x90 SUB_B
+    &&subtractRegister,            // 0x91 SUB_C
+    &&subtractRegister,            // 0x92 SUB_D
+    &&subtractRegister,            // 0x93 SUB_E
+    &&subtractRegister,            // 0x94 SUB_H
+    &&subtractRegister,            // 0x95 SUB_L
+    &&subtractMemory,              // 0x96 SUB_M
+    &&subtractRegister,            // 0x97 SUB_A
+    &&subtractWithBorrowRegister,  // 0x98 SBB_B
+    &&subtractWithBorrowRegister,  // 0x99 SBB_C
+    &&subtractWithBorrowRegister,  // 0x9a SBB_D
+    &&subtractWithBorrowRegister,  // 0x9b SBB_E
+    &&subtractWithBorrowRegister,  // 0x9c SBB_H
+    &&subtractWithBorrowRegister,  // 0x9d SBB_L
+    &&subtractWithBorrowMemory,    // 0x9e SBB_M
+    &&subtractWithBorrowRegister,  // 0x9f SBB_A
+    &&andRegister,                 // 0xa0 ANA_B
+    &&andRegister,                 // 0xa1 ANA_C
+    &&andRegister,                 // 0xa2 ANA_D
+    &&andRegister,                 // 0xa3 ANA_E
+    &&andRegister,                 // 0xa4 ANA_H
+    &&andRegister,                 // 0xa5 ANA_L
+    &&andMemory,                   // 0xa6 ANA_M
+    &&andRegister,                 // 0xa7 ANA_A
+    &&xorRegister,                 // 0xa8 XRA_B
+    &&xorRegister,                 // 0xa9 XRA_C
+    &&xorRegister,                 // 0xaa XRA_D
+    &&xorRegister,                 // 0xab XRA_E
+    &&xorRegister,                 // 0xac XRA_H
+    &&xorRegister,                 // 0xad XRA_L
+    &&xorMemory,                   // 0xae XRA_M
+    &&xorRegister,                 // 0xaf XRA_A
+    &&orRegister,                  // 0xb0 ORA_B
+    &&orRegister,                  // 0xb1 ORA_C
+    &&orRegister,                  // 0xb2 ORA_D
+    &&orRegister,                  // 0xb3 ORA_E
+    &&orRegister,                  // 0xb4 ORA_H
+    &&orRegister,                  // 0xb5 ORA_L
+    &&orMemory,                    // 0xb6 ORA_M
+    &&orRegister,                  // 0xb7 ORA_A
+    &&compareRegister,             // 0xb8 CMP_B
+    &&compareRegister,             // 0xb9 CMP_C
+    &&compareRegister,             // 0xba CMP_D
+    &&compareRegister,             // 0xbb CMP_E
+    &&compareRegister,             // 0xbc CMP_H
+    &&compareRegister,             // 0xbd CMP_L
+    &&compareMemory,               // 0xbe CMP_M
+    &&compareRegister,             // 0xbf CMP_A
+    &&conditionalReturn,           // 0xc0 RNZ
+    &&popRegisterPair,             // 0xc1 POP_B
+    &&conditionalJump,             // 0xc2 JNZ
+    &&jump,                        // 0xc3 JMP
+    &&conditionalCall,             // 0xc4 CNZ
+    &&pushRegisterPair,            // 0xc5 PUSH_B
+    &&addImmediate,                // 0xc6 ADI
+    &&restart,                     // 0xc7 RST_0
+    &&conditionalReturn,           // 0xc8 RZ
+    &&returnFromCall,              // 0xc9 RET
+    &&conditionalJump,             // 0xca JZ
+    &&unhandledOpCode,             // 0xcb -
+    &&conditionalCall,             // 0xcc CZ
+    &&call,                        // 0xcd CALL
+    &&addWithCarryImmediate,       // 0xce ACI
+    &&restart,                     // 0xcf RST_1
+    &&conditionalReturn,           // 0xd0 RNC
+    &&popRegisterPair,             // 0xd1 POP_D
+    &&conditionalJump,             // 0xd2 JNC
+    &&output,                      // 0xd3 OUT
+    &&conditionalCall,             // 0xd4 CNC
+    &&pushRegisterPair,            // 0xd5 PUSH_D
+    &&subtractImmediate,           // 0xd6 SUI
+    &&restart,                     // 0xd7 RST_2
+    &&conditionalReturn,           // 0xd8 RC
+    &&unhandledOpCode,             // 0xd9 -
+    &&conditionalJump,             // 0xda JC
+    &&input,                       // 0xdb IN
+    &&conditionalCall,             // 0xdc CC
+    &&unhandledOpCode,             // 0xdd -
+    &&subtractWithBorrowImmediate, // 0xde SBI
+    &&restart,                     // 0xdf RST_3
+    &&conditionalReturn,           // 0xe0 RPO
+    &&popRegisterPair,             // 0xe1 POP_H
+    &&conditionalJump,             // 0xe2 JPO
+    &&exchangeStackTopWithHL,      // 0xe3 XTHL
+    &&conditionalCall,             // 0xe4 CPO
+    &&pushRegisterPair,            // 0xe5 PUSH_H
+    &&andImmediate,                // 0xe6 ANI
+    &&restart,                     // 0xe7 RST_4
+    &&conditionalReturn,           // 0xe8 RPE
+    &&jumpToHL,                    // 0xe9 PCHL
+    &&conditionalJump,             // 0xea JPE
+    &&exchangeHLWithDE,            // 0xeb XCHG
+    &&conditionalCall,             // 0xec CPE
+    &&unhandledOpCode,             // 0xed -
+    &&xorImmediate,                // 0xee XRI
+    &&restart,                     // 0xef RST_5
+    &&conditionalReturn,           // 0xf0 RP
+    &&popAccumulatorAndStatus,     // 0xf1 POP_PSW
+    &&conditionalJump,             // 0xf2 JP
+    &&disableInterrupts,           // 0xf3 DI
+    &&conditionalCall,             // 0xf4 CP
+    &&pushAccumulatorAndStatus,    // 0xf5 PUSH_PSW
+    &&orImmediate,                 // 0xf6 ORI
+    &&restart,                     // 0xf7 RST_6
+    &&conditionalReturn,           // 0xf8 RM
+    &&loadStackPointerFromHL,      // 0xf9 SPHL
+    &&conditionalJump,             // 0xfa JM
+    &&enableInterrupts,            // 0xfb EI
+    &&conditionalCall,             // 0xfc CM
+    &&unhandledOpCode,             // 0xfd -
+    &&compareImmediate,            // 0xfe CPI
+    &&restart                      // 0xff RST_7
+  };
+
+  uint8_t opCode;
+  uint16_t operand;
+
+  FETCH_AND_DISPATCH();
+
+noOperation:
+  DISPATCH();
+
+unhandledOpCode:
+  raiseFault(UNHANDLED_OP_CODE_FAULT, opCode);
+  programCounter++;
+  DISPATCH();
+
+quit:
+  runProgram = false;
+  DISPATCH();
+
+halt:
+  halt = true;
+  DISPATCH();
+
+loadRegisterPairImmediate:
+  replaceRegisterPair(registerPairFromOpCode(opCode), operand >> 8, operand & 0xff);
+  DISPATCH();
+
+loadStackPointerImmediate:
+  stackPointer = operand;
+  DISPATCH();
+
+storeAccumulatorIndirect:
+  writeMemory(*registerPairFromOpCode(opCode), registerA);
+  DISPATCH();
+
+loadAccumulatorIndirect:
+  registerA = memory[*registerPairFromOpCode(opCode)];
+  DISPATCH();
+
+storeAccumulatorDirect:
+  writeMemory(operand, registerA);
+  DISPATCH();
+
+loadAccumulatorDirect:
+  registerA = memory[operand];
+  DISPATCH();
+
+storeHLDirect:
+  writeWord(operand, registerPairs[REGISTER_PAIR_H]);
+  DISPATCH();
+
+loadHLDirect:
+  registerPairs[REGISTER_PAIR_H] = readWord(operand);
+  DISPATCH();
+
+incrementRegisterPair:
+  incrementRegisterPair(registerPairFromOpCode(opCode));
+  DISPATCH();
+
+decrementRegisterPair:
+  decrementRegisterPair(registerPairFromOpCode(opCode));
+  DISPATCH();
+
+incrementStackPointer:
+  stackPointer++;
+  DISPATCH();
+
+decrementStackPointer:
+  stackPointer--;
+  DISPATCH();
+
+incrementRegister:
+  incrementWithFlagTables(registerFromIndex(opCode >> 3 & 7));
+  DISPATCH();
+
+decrementRegister:
+  decrementWithFlagTables(registerFromIndex(opCode >> 3 & 7));
+  DISPATCH();
+
+incrementMemory:
+  {
+    uint8_t value = registerM();
+
+    incrementWithFlagTables(&value);
+    writeMemory(currentMemoryAddress(), value);
+  }
+  DISPATCH();
+
+decrementMemory:
+  {
+    uint8_t value = registerM();
+
+    decrementWithFlagTables(&value);
+    writeMemory(currentMemoryAddress(), value);
+  }
+  DISPATCH();
+
+moveImmediate:
+  *registerFromIndex(opCode >> 3 & 7) = operand & 0xff;
+  DISPATCH();
+
+moveImmediateToMemory:
+  writeMemory(currentMemoryAddress(), operand & 0xff);
+  DISPATCH();
+
+moveRegisterToRegister:
+  *registerFromIndex(opCode >> 3 & 7) = *registerFromIndex(opCode & 7);
+  DISPATCH();
+
+moveRegisterToMemory:
+  writeMemory(currentMemoryAddress(), *registerFromIndex(opCode & 7));
+  DISPATCH();
+
+moveMemoryToRegister:
+  *registerFromIndex(opCode >> 3 & 7) = registerM();
+  DISPATCH();
+
+rotateLeft:
+  rotateAccumulatorLeft();
+  DISPATCH();
+
+rotateRight:
+  rotateAccumulatorRight();
+  DISPATCH();
+
+rotateLeftThroughCarry:
+  rotateAccumulatorLeftWithCarry();
+  DISPATCH();
+
+rotateRightThroughCarry:
+  rotateAccumulatorRightWithCarry();
+  DISPATCH();
+
+addRegisterPairToH:
+  addValueToRegisterPairH(valueOfRegisterPair(registerPairFromOpCode(opCode)));
+  DISPATCH();
+
+addStackPointerToH:
+  addValueToRegisterPairH(stackPointer);
+  DISPATCH();
+
+decimalAdjustAccumulator:
+  decimalAdjustWithFlagTables();
+  DISPATCH();
+
+complementAccumulator:
+  complimentAccumulator();
+  DISPATCH();
+
+setCarry:
+  setStatus(CARRY_BIT);
+  DISPATCH();
+
+complementCarry:
+  flipStatusBit(CARRY_BIT);
+  DISPATCH();
+
+addRegister:
+  addWithFlagTables(registerValueFromOpCode(opCode), 0);
+  DISPATCH();
+
+addMemory:
+  addWithFlagTables(registerM(), 0);
+  DISPATCH();
+
+addImmediate:
+  addWithFlagTables(operand & 0xff, 0);
+  DISPATCH();
+
+addWithCarryRegister:
+  addWithFlagTables(registerValueFromOpCode(opCode), carryBitSet());
+  DISPATCH();
+
+addWithCarryMemory:
+  addWithFlagTables(registerM(), carryBitSet());
+  DISPATCH();
+
+addWithCarryImmediate:
+  addWithFlagTables(operand & 0xff, carryBitSet());
+  DISPATCH();
+
+subtractRegister:
+  subtractWithFlagTables(registerValueFromOpCode(opCode), 0);
+  DISPATCH();
+
+subtractMemory:
+  subtractWithFlagTables(registerM(), 0);
+  DISPATCH();
+
+subtractImmediate:
+  subtractWithFlagTables(operand & 0xff, 0);
+  DISPATCH();
+
+subtractWithBorrowRegister:
+  subtractWithFlagTables(registerValueFromOpCode(opCode), carryBitSet());
+  DISPATCH();
+
+subtractWithBorrowMemory:
+  subtractWithFlagTables(registerM(), carryBitSet());
+  DISPATCH();
+
+subtractWithBorrowImmediate:
+  subtractWithFlagTables(operand & 0xff, carryBitSet());
+  DISPATCH();
+
+andRegister:
+  andWithFlagTables(registerValueFromOpCode(opCode));
+  DISPATCH();
+
+andMemory:
+  andWithFlagTables(registerM());
+  DISPATCH();
+
+andImmediate:
+  andWithFlagTables(operand & 0xff);
+  DISPATCH();
+
+xorRegister:
+  xorWithFlagTables(registerValueFromOpCode(opCode));
+  DISPATCH();
+
+xorMemory:
+  xorWithFlagTables(registerM());
+  DISPATCH();
+
+xorImmediate:
+  xorWithFlagTables(operand & 0xff);
+  DISPATCH();
+
+orRegister:
+  orWithFlagTables(registerValueFromOpCode(opCode));
+  DISPATCH();
+
+orMemory:
+  orWithFlagTables(registerM());
+  DISPATCH();
+
+orImmediate:
+  orWithFlagTables(operand & 0xff);
+  DISPATCH();
+
+compareRegister:
+  compareWithFlagTables(registerValueFromOpCode(opCode));
+  DISPATCH();
+
+compareMemory:
+  compareWithFlagTables(registerM());
+  DISPATCH();
+
+compareImmediate:
+  compareWithFlagTables(operand & 0xff);
+  DISPATCH();
+
+pushRegisterPair:
+  pushRegisterPairOnStack(registerPairFromOpCode(opCode));
+  DISPATCH();
+
+popRegisterPair:
+  popStackToRegisterPair(registerPairFromOpCode(opCode));
+  DISPATCH();
+
+popAccumulatorAndStatus:
+  popStackToAccumulatorAndStatusPair();
+  DISPATCH();
+
+pushAccumulatorAndStatus:
+  pushAccumulatorAndStatusPairOnStack();
+  DISPATCH();
+
+exchangeStackTopWithHL:
+  exchangeRegistersAndMemory();
+  DISPATCH();
+
+exchangeHLWithDE:
+  exchangeRegisterPairs(&registerPairs[REGISTER_PAIR_D], &registerPairs[REGISTER_PAIR_H]);
+  DISPATCH();
+
+loadStackPointerFromHL:
+  stackPointer = currentMemoryAddress();
+  DISPATCH();
+
+jump:
+  if (FOLLOW_JUMPS)
+  {
+    programCounter = operand;
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+  DISPATCH();
+
+conditionalJump:
+  if (!FOLLOW_JUMPS)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    programCounter = operand;
+  }
+  DISPATCH();
+
+jumpToHL:
+  if (FOLLOW_JUMPS)
+  {
+    programCounter = currentMemoryAddress();
+  }
+  DISPATCH();
+
+call:
+  if (FOLLOW_JUMPS)
+  {
+    push2ByteValueOnStack(programCounter);
+    programCounter = operand;
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+  DISPATCH();
+
+conditionalCall:
+  if (!FOLLOW_JUMPS)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    push2ByteValueOnStack(programCounter);
+    programCounter = operand;
+    cycles += branchTakenCycles(opCode);
+  }
+  DISPATCH();
+
+returnFromCall:
+  if (FOLLOW_JUMPS)
+  {
+    programCounter = pop2ByteValueFromStack();
+  }
+  else
+  {
+    skipControlTransfer(opCode);
+  }
+  DISPATCH();
+
+conditionalReturn:
+  if (!FOLLOW_JUMPS)
+  {
+    skipControlTransfer(opCode);
+  }
+  else if (conditionMet(opCode))
+  {
+    programCounter = pop2ByteValueFromStack();
+    cycles += branchTakenCycles(opCode);
+  }
+  DISPATCH();
+
+restart:
+  handleInterrupt(opCode);
+  DISPATCH();
+
+input:
+  inputFromPort<Ports>(operand & 0xff);
+  DISPATCH();
+
+output:
+  outputToPort<Ports>(operand & 0xff);
+  DISPATCH();
+
+disableInterrupts:
+  ignoreInterrupts = true;
+  DISPATCH();
+
+enableInterrupts:
+  ignoreInterrupts = false;
+  DISPATCH();
+}
+
+// The type-erased core, and the one the Space Invaders cabinet runs
+template void CPU::runThreaded<PortHandler, ALL_CORE_FEATURES>();
+template void CPU::runThreaded<SpaceInvaders, 0>();
+
+#endif
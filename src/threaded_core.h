@@ -0,0 +1,10 @@
+#ifndef THREADED_CORE_H
+#define THREADED_CORE_H
+
+// The threaded core needs labels as values, which GCC and Clang provide.
+// Build with -DNO_THREADED_CORE to fall back to the table core.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(NO_THREADED_CORE)
+#define HAS_THREADED_CORE
+#endif
+
+#endif
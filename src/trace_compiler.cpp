@@ -0,0 +1,550 @@
+#include <stdio.h>
+
+#include "cpu.h"
+#include "op_code_info.h"
+#include "op_codes.h"
+#include "trace_compiler.h"
+
+#ifdef HAS_TRACE_COMPILER
+
+#include <chrono>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COMPILER_IDLE_WAIT std::chrono::milliseconds(1)
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t hashBytes(const uint8_t *bytes, size_t length)
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+
+  return hash;
+}
+
+TraceCompiler::TraceCompiler() : stopping(false), inFlight(0)
+{
+}
+
+TraceCompiler::TraceCompiler(const TraceCompiler &other) : stopping(false), inFlight(0)
+{
+}
+
+TraceCompiler::~TraceCompiler()
+{
+  stop();
+}
+
+TraceCompiler &TraceCompiler::operator=(const TraceCompiler &other)
+{
+  stop();
+  return *this;
+}
+
+/*
+ * Loads a trace from the cache, compiling it first if it is not there yet.
+ * The shared object is built under a temporary name and renamed into place,
+ * so another emulator sharing the cache never loads a half-written file. A
+ * trace that fails to build is left with no run function.
+ */
+void TraceCompiler::build(Trace *trace)
+{
+  trace->library = dlopen(trace->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+  if (!trace->library)
+  {
+    char suffix[64];
+
+    snprintf(suffix, sizeof(suffix), ".%ld.%p", (long)getpid(), (void *)trace);
+
+    string sourcePath = trace->path + suffix + ".c";
+    string libraryPath = trace->path + suffix + ".so";
+    string command = string(TRACE_COMPILE_COMMAND) + " -o '" + libraryPath + "' '" + sourcePath + "' 2>/dev/null";
+
+    mkdir(trace->directory.c_str(), 0777);
+    ofstream(sourcePath.c_str()) << trace->source;
+
+    if (system(command.c_str()) == 0 && rename(libraryPath.c_str(), trace->path.c_str()) == 0)
+    {
+      trace->library = dlopen(trace->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    }
+
+    remove(sourcePath.c_str());
+    remove(libraryPath.c_str());
+  }
+
+  trace->run = trace->library ? (TraceFunction)dlsym(trace->library, trace->symbol.c_str()) : NULL;
+}
+
+/*
+ * Hands a trace to the compiler thread. Fails without waiting if the queues
+ * are full, in which case the caller still owns the trace.
+ */
+bool TraceCompiler::queue(Trace *trace)
+{
+  if (inFlight == TRACE_QUEUE_SIZE || !requests.push(trace))
+  {
+    return false;
+  }
+
+  inFlight++;
+
+  if (!worker.joinable())
+  {
+    worker = std::thread(&TraceCompiler::run, this);
+  }
+
+  wake.notify_one();
+  return true;
+}
+
+/*
+ * The next trace the compiler thread is done with, or NULL if there is none
+ * yet. The caller either keeps it or deletes it.
+ */
+Trace *TraceCompiler::takeResult()
+{
+  Trace *trace;
+
+  if (inFlight == 0 || !results.pop(&trace))
+  {
+    return NULL;
+  }
+
+  inFlight--;
+  return trace;
+}
+
+void TraceCompiler::keep(Trace *trace)
+{
+  traces.push_back(trace);
+}
+
+size_t TraceCompiler::loadedTraces()
+{
+  size_t loaded = 0;
+
+  for (size_t i = 0; i < traces.size(); i++)
+  {
+    loaded += traces[i]->run != NULL;
+  }
+
+  return loaded;
+}
+
+/*
+ * Joins the compiler thread, drops the traces it had not handed back and
+ * unloads every trace, so no block may run one after this.
+ */
+void TraceCompiler::stop()
+{
+  if (worker.joinable())
+  {
+    stopping = true;
+    wake.notify_one();
+    worker.join();
+    stopping = false;
+  }
+
+  Trace *trace;
+
+  while (requests.pop(&trace) || results.pop(&trace))
+  {
+    trace->block->compiling = false;
+    release(trace);
+  }
+
+  for (size_t i = 0; i < traces.size(); i++)
+  {
+    release(traces[i]);
+  }
+
+  traces.clear();
+  inFlight = 0;
+}
+
+void TraceCompiler::run()
+{
+  while (!stopping)
+  {
+    Trace *trace;
+
+    if (!requests.pop(&trace))
+    {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+
+      wake.wait_for(lock, COMPILER_IDLE_WAIT);
+      continue;
+    }
+
+    build(trace);
+    results.push(trace);
+  }
+}
+
+void TraceCompiler::release(Trace *trace)
+{
+  if (trace->library)
+  {
+    dlclose(trace->library);
+  }
+
+  delete trace;
+}
+
+/*
+ * Records the trace that starts at a hot block and queues it for the host
+ * compiler, or builds it on the spot without background compilation. Only
+ * returns true when the block has a trace that can run now.
+ */
+bool CPU::compileTrace(Block *block)
+{
+  Trace *trace = new Trace();
+  char name[64];
+
+  snprintf(name, sizeof(name), "trace%04x", block->address);
+  trace->block = block;
+  trace->symbol = name;
+  trace->source = traceSource(block->address, trace->symbol, &trace->pages);
+  trace->library = NULL;
+  trace->run = NULL;
+
+  if (trace->source.empty())
+  {
+    delete trace;
+    return false;
+  }
+
+  // A store into the trace's own pages has to end it, as it ends a block,
+  // even where no block has been decoded yet.
+  for (size_t i = 0; i < trace->pages.size(); i++)
+  {
+    blockCache.markCode(trace->pages[i]);
+    trace->generations.push_back(blockCache.writeGeneration(trace->pages[i]));
+  }
+
+  snprintf(name, sizeof(name), "/%016llx-%04x-%016llx-%d.so", (unsigned long long)hashBytes(memory.data(), programLength),
+    block->address, (unsigned long long)hashBytes((const uint8_t *)trace->source.data(), trace->source.size()), TRACE_FORMAT_VERSION);
+  trace->directory = traceCacheDirectory;
+  trace->path = traceCacheDirectory + name;
+
+  if (!backgroundCompilation)
+  {
+    TraceCompiler::build(trace);
+    installTrace(trace);
+    return block->trace != NULL;
+  }
+
+  block->compiling = traceCompiler.queue(trace);
+
+  if (!block->compiling)
+  {
+    // The queue is full, so try again once the block is hot again.
+    block->executions = 0;
+    delete trace;
+  }
+
+  return false;
+}
+
+void CPU::installTraces()
+{
+  Trace *trace;
+
+  while ((trace = traceCompiler.takeResult()))
+  {
+    trace->block->compiling = false;
+    installTrace(trace);
+  }
+}
+
+/*
+ * Attaches a built trace to its block, unless a store has retired the block
+ * or written to one of the trace's pages since the trace was recorded.
+ */
+void CPU::installTrace(Trace *trace)
+{
+  traceCompiler.keep(trace);
+
+  if (trace->run && !trace->block->retired && traceIsCurrent(trace))
+  {
+    trace->block->trace = trace;
+  }
+}
+
+bool CPU::traceIsCurrent(const Trace *trace)
+{
+  for (size_t i = 0; i < trace->pages.size(); i++)
+  {
+    if (blockCache.writeGeneration(trace->pages[i]) != trace->generations[i])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool CPU::runTrace(Block *block)
+{
+  const Trace *trace = block->trace;
+
+  if (!traceIsCurrent(trace))
+  {
+    block->trace = NULL;
+    return false;
+  }
+
+  trace->run(this, registers, memory.data(), &programCounter, &cycles, cycleLimit, &CPU::executeTraceCallOut);
+  return true;
+}
+
+int CPU::executeTraceCallOut(void *cpu, unsigned opCode, unsigned operand)
+{
+  CPU *self = (CPU *)cpu;
+
+  (self->*instructionTable[opCode].handler)(opCode, operand);
+  return self->blockCache.codeInvalidated;
+}
+
+/*
+ * The C statement for an instruction that only moves data, the same set the
+ * JIT and the recompiler compile inline, or an empty string if it has to
+ * call its interpreter handler.
+ */
+string CPU::traceStatement(uint8_t opCode, uint16_t operand)
+{
+  uint8_t destination = opCode >> 3 & 7;
+  uint8_t source = opCode & 7;
+  uint8_t pair = opCode >> 4 & 3;
+  char text[160] = "";
+
+  if (opCode >= MOV_B_B && opCode <= MOV_A_A && opCode != HLT && destination != REGISTER_M)
+  {
+    if (source == REGISTER_M)
+    {
+      snprintf(text, sizeof(text), "r[%d] = memory[pairs[%d]];", destination ^ REGISTER_INDEX_SWAP, REGISTER_PAIR_H);
+    }
+    else
+    {
+      snprintf(text, sizeof(text), "r[%d] = r[%d];", destination ^ REGISTER_INDEX_SWAP, source ^ REGISTER_INDEX_SWAP);
+    }
+  }
+  else if ((opCode & 0xc7) == MVI_B && destination != REGISTER_M)
+  {
+    snprintf(text, sizeof(text), "r[%d] = 0x%02x;", destination ^ REGISTER_INDEX_SWAP, operand & 0xff);
+  }
+  else if ((opCode & 0xcf) == LXI_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "pairs[%d] = 0x%04x;", pair, operand);
+  }
+  else if ((opCode & 0xcf) == INX_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "pairs[%d]++;", pair);
+  }
+  else if ((opCode & 0xcf) == DCX_B && pair != 3)
+  {
+    snprintf(text, sizeof(text), "pairs[%d]--;", pair);
+  }
+  else if (opCode == XCHG)
+  {
+    snprintf(text, sizeof(text), "{ uint16_t de = pairs[%d]; pairs[%d] = pairs[%d]; pairs[%d] = de; }",
+      REGISTER_PAIR_D, REGISTER_PAIR_D, REGISTER_PAIR_H, REGISTER_PAIR_H);
+  }
+  else if (opCode == LDX_B || opCode == LDX_D)
+  {
+    snprintf(text, sizeof(text), "r[%d] = memory[pairs[%d]];", REGISTER_A ^ REGISTER_INDEX_SWAP, pair);
+  }
+  else if (opCode == LDA)
+  {
+    snprintf(text, sizeof(text), "r[%d] = memory[0x%04x];", REGISTER_A ^ REGISTER_INDEX_SWAP, operand);
+  }
+  else if (opCode == LXLD && operand != 0xffff)
+  {
+    snprintf(text, sizeof(text), "pairs[%d] = memory[0x%04x] << 8 | memory[0x%04x];", REGISTER_PAIR_H, operand + 1, operand);
+  }
+  else if (opCode == CMA)
+  {
+    snprintf(text, sizeof(text), "r[%d] = ~r[%d];", REGISTER_A ^ REGISTER_INDEX_SWAP, REGISTER_A ^ REGISTER_INDEX_SWAP);
+  }
+
+  return text;
+}
+
+/*
+ * Where a trace goes after a control transfer: the target of a jump, call
+ * or RST, a conditional jump backwards (a loop), or the next instruction
+ * after a conditional jump forwards or a conditional call or return.
+ * Returns false for returns and PCHL, which end the trace.
+ */
+static bool predictSuccessor(uint8_t opCode, uint16_t address, uint16_t operand, uint32_t *next)
+{
+  const OpCodeInfo &info = opCodeInfo(opCode);
+  uint16_t fallThrough = address + info.length;
+
+  if (info.attributes & OP_CODE_RESTART)
+  {
+    *next = opCode & 0x38;
+  }
+  else if ((info.attributes & (OP_CODE_JUMP | OP_CODE_CALL)) && info.length == 3)
+  {
+    *next = (info.attributes & OP_CODE_CONDITIONAL) && (info.attributes & OP_CODE_CALL || operand > address) ? fallThrough : operand;
+  }
+  else if ((info.attributes & OP_CODE_RETURN) && (info.attributes & OP_CODE_CONDITIONAL))
+  {
+    *next = fallThrough;
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Writes the C source for the trace starting at address, and the pages it
+ * reads its instructions from. Every instruction that is not compiled
+ * inline calls its handler with the program counter and cycles brought up
+ * to date. Wherever the block core would start a new block, the trace leaves
+ * if the cycle budget has run out or control went somewhere other than the
+ * recorded path, so it stops exactly where runBlocks() would.
+ *
+ * The trace only ever holds whole blocks. It ends at a return or PCHL, at
+ * code it has already visited and at idle and copy loops, which runBlocks()
+ * handles itself. A block with I/O, HLT, QUIT or an unhandled op code or
+ * past the end of the program is left out, along with the rest of the path.
+ * Returns an empty string if not even the first block qualifies.
+ */
+string CPU::traceSource(uint16_t address, string symbol, vector<uint8_t> *pages)
+{
+  string body;
+  set<uint32_t> visited;
+  uint32_t pc = address;
+  uint32_t blockStart = address;
+  uint32_t blockInstructions = 0;
+  uint32_t pendingCycles = 0;
+  size_t wholeBlocks = 0;
+  char text[256];
+
+  for (int count = 0; count < MAX_TRACE_INSTRUCTIONS && !visited.count(pc); count++)
+  {
+    uint8_t opCode = memory[pc];
+    const OpCodeInfo &info = opCodeInfo(opCode);
+    uint16_t operand = (info.length > 1 ? memory[(uint16_t)(pc + 1)] : 0) | (info.length > 2 ? memory[(uint16_t)(pc + 2)] << 8 : 0);
+    Block *block = blockCache.blockAt(pc);
+
+    if (blockInstructions == 0 && count > 0 && block && (block->idleLoop || block->memoryLoop.kind != NO_MEMORY_LOOP))
+    {
+      break;
+    }
+
+    if (pc + info.length > programLength ||
+      (info.attributes & (OP_CODE_IO | OP_CODE_HALT | OP_CODE_QUIT | OP_CODE_UNDEFINED | OP_CODE_TRAP)) || interpreterLength(opCode) == 0)
+    {
+      break;
+    }
+
+    string statement = traceStatement(opCode, operand);
+    uint32_t next = pc + info.length;
+    char instruction[32];
+
+    visited.insert(pc);
+
+    if (pages->empty() || pages->back() != pc >> 8)
+    {
+      pages->push_back(pc >> 8);
+    }
+
+    if ((next - 1) >> 8 != pages->back())
+    {
+      pages->push_back((next - 1) >> 8);
+    }
+
+    disassembleInstruction(&memory[pc], instruction, sizeof(instruction));
+    pendingCycles += interpreterCycles(opCode);
+    blockInstructions++;
+
+    if (!statement.empty())
+    {
+      snprintf(text, sizeof(text), "  %s // %s\n", statement.c_str(), instruction);
+      body += text;
+    }
+    else
+    {
+      snprintf(text, sizeof(text), "  *pc = 0x%04x;\n  *cycles += %u;\n\n  if (execute(cpu, 0x%02x, 0x%04x)) // %s\n  {\n    return;\n  }\n\n",
+        next, pendingCycles, opCode, operand, instruction);
+      body += text;
+      pendingCycles = 0;
+    }
+
+    if (info.attributes & OP_CODE_ENDS_BLOCK)
+    {
+      wholeBlocks = body.size();
+
+      if (!predictSuccessor(opCode, pc, operand, &next))
+      {
+        break;
+      }
+
+      snprintf(text, sizeof(text), "  if (*pc != 0x%04x || *cycles >= cycleLimit)\n  {\n    return;\n  }\n\n", next);
+      body += text;
+      wholeBlocks = body.size();
+      blockStart = next;
+      blockInstructions = 0;
+    }
+    else if (blockInstructions == MAX_BLOCK_INSTRUCTIONS || next - blockStart + 3 >= BLOCK_PAGE_SIZE)
+    {
+      if (!statement.empty())
+      {
+        snprintf(text, sizeof(text), "  *pc = 0x%04x;\n  *cycles += %u;\n", next, pendingCycles);
+        body += text;
+        pendingCycles = 0;
+      }
+
+      body += "\n  if (*cycles >= cycleLimit)\n  {\n    return;\n  }\n\n";
+      wholeBlocks = body.size();
+      blockStart = next;
+      blockInstructions = 0;
+    }
+
+    pc = next & 0xffff;
+  }
+
+  if (wholeBlocks == 0)
+  {
+    return "";
+  }
+
+  body.resize(wholeBlocks);
+
+  if (body.size() > 1 && body.compare(body.size() - 2, 2, "\n\n") == 0)
+  {
+    body.resize(body.size() - 1);
+  }
+
+  return "#include <stdint.h>\n\n"
+    "typedef int (*TraceCallOut)(void *cpu, unsigned opCode, unsigned operand);\n\n"
+    "void " + symbol + "(void *cpu, uint8_t *r, uint8_t *memory, uint16_t *pc, uint64_t *cycles, uint64_t cycleLimit, TraceCallOut execute)\n"
+    "{\n  uint16_t *pairs = (uint16_t *)r;\n\n" + body + "}\n";
+}
+
+#endif
+
+size_t CPU::loadedTraces()
+{
+#ifdef HAS_TRACE_COMPILER
+  return traceCompiler.loadedTraces();
+#else
+  return 0;
+#endif
+}
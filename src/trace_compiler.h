@@ -0,0 +1,100 @@
+#ifndef TRACE_COMPILER_H
+#define TRACE_COMPILER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "single_producer_queue.h"
+
+// Traces are compiled by the host C compiler and loaded with dlopen(), so
+// they need a POSIX host. Build with -DNO_TRACE_COMPILER to fall back to the
+// block core.
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(NO_TRACE_COMPILER)
+#define HAS_TRACE_COMPILER
+#endif
+
+#define TRACE_THRESHOLD 1024
+#define MAX_TRACE_INSTRUCTIONS 128
+#define TRACE_QUEUE_SIZE 16
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_COMPILE_COMMAND "cc -O2 -shared -fPIC"
+#define DEFAULT_TRACE_CACHE_DIRECTORY "trace_cache"
+
+using namespace std;
+
+#ifdef HAS_TRACE_COMPILER
+
+struct Block;
+
+/*
+ * The C calling convention of a compiled trace. Registers points at the
+ * CPU's register file, and every instruction that is not compiled inline
+ * is run by execute(), which returns non-zero once the instruction has
+ * stored into decoded code.
+ */
+typedef int (*TraceCallOut)(void *cpu, unsigned opCode, unsigned operand);
+typedef void (*TraceFunction)(void *cpu, uint8_t *registers, uint8_t *memory, uint16_t *programCounter, uint64_t *cycles, uint64_t cycleLimit, TraceCallOut execute);
+
+/*
+ * A hot path through the guest code, starting at block and following the
+ * jumps and calls it expects to be taken. The trace runs only while each of
+ * its pages is still at the write generation it was recorded at. Path names
+ * the shared object in the cache, which is keyed by the ROM, the address
+ * and the source itself.
+ */
+struct Trace
+{
+  Block *block;
+  string source;
+  string directory;
+  string path;
+  string symbol;
+  vector<uint8_t> pages;
+  vector<uint64_t> generations;
+  void *library;
+  TraceFunction run;
+};
+
+/*
+ * Compiles traces with the host compiler on a thread of its own, started
+ * when the first trace is queued, and owns the loaded traces. As with the
+ * JIT's background compiler, the emulation thread never waits: it queues a
+ * trace and picks it up once it has been built or loaded from the cache.
+ * Copying a CPU gives the copy a compiler of its own with no traces.
+ */
+class TraceCompiler
+{
+  public:
+    TraceCompiler();
+    TraceCompiler(const TraceCompiler &other);
+    ~TraceCompiler();
+    TraceCompiler &operator=(const TraceCompiler &other);
+    static void build(Trace *trace);
+    bool queue(Trace *trace);
+    Trace *takeResult();
+    void keep(Trace *trace);
+    size_t loadedTraces();
+    void stop();
+
+  private:
+    std::thread worker;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+    size_t inFlight;
+    SingleProducerQueue<Trace *, TRACE_QUEUE_SIZE> requests;
+    SingleProducerQueue<Trace *, TRACE_QUEUE_SIZE> results;
+    vector<Trace *> traces;
+    void run();
+    static void release(Trace *trace);
+};
+
+#endif
+
+#endif
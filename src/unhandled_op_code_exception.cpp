@@ -5,13 +5,13 @@
 
 UnhandledOpCodeException::UnhandledOpCodeException(uint8_t opCode) : opCode(opCode)
 {
+  stringstream stream;
+
+  stream << "Unhandled Op Code: 0x" << hex << setfill('0') << setw(2) << (int)opCode;
+  message = stream.str();
 }
 
 const char *UnhandledOpCodeException::what() const throw()
 {
-  stringstream stream;
-  string message = "Unhandled Op Code: 0x";
-
-  stream << hex << setfill('0') << setw(2) << (int)opCode;
-  return (message + stream.str()).c_str();
+  return message.c_str();
 }
@@ -1,6 +1,7 @@
 #ifndef UNHANDLED_OP_CODE_EXCEPTION_H
 #define UNHANDLED_OP_CODE_EXCEPTION_H
 
+#include <cstdint>
 #include <exception>
 #include <string>
 
@@ -13,6 +14,7 @@ class UnhandledOpCodeException: public exception
     virtual const char *what() const throw();
   private:
     uint8_t opCode;
+    string message;
 };
 
 #endif
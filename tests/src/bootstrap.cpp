@@ -1,4 +1,31 @@
-#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_RUNNER
+
+#include <string>
 
 #include "catch.hpp"
 
+#include "../../src/cpu.h"
+
+int main(int argc, char *argv[])
+{
+  Catch::Session session;
+  string coreName = CPU::nameOfCore(CPU::defaultCore);
+
+  session.cli(session.cli()
+    | Catch::clara::Opt(coreName, "switch|table|threaded|block|jit|aot|trace")["--core"]("the CPU core the tests run against")
+    | Catch::clara::Opt(CPU::defaultLazyFlags)["--lazy-flags"]("run the tests with lazy flag evaluation"));
+
+  int returnCode = session.applyCommandLine(argc, argv);
+  if (returnCode != 0)
+  {
+    return returnCode;
+  }
+
+  if (!CPU::coreFromName(coreName, &CPU::defaultCore))
+  {
+    printf("Unknown CPU core: %s\n", coreName.c_str());
+    return 1;
+  }
+
+  return session.run();
+}
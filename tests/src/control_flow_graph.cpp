@@ -0,0 +1,125 @@
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "../../src/control_flow.h"
+#include "../../src/cpu.h"
+#include "../../src/op_codes.h"
+
+#define DISPATCH_PROGRAM_SIZE 0x62
+
+// Jumps past the RST vectors, calls a subroutine, then dispatches through a
+// table of two addresses with PCHL.
+static void buildDispatchProgram(uint8_t *program)
+{
+  uint8_t main[13] = { MVI_A, 0x01, CALL, 0x60, 0x00, LXI_H, 0x50, 0x00, MOV_E_M, INX_H, MOV_D_M, XCHG, PCHL };
+
+  memset(program, NOP, DISPATCH_PROGRAM_SIZE);
+  program[0x00] = JMP;
+  program[0x01] = 0x40;
+  memcpy(&program[0x40], main, sizeof(main));
+  program[0x50] = 0x54;
+  program[0x52] = 0x58;
+  program[0x54] = INR_A;
+  program[0x55] = QUIT;
+  program[0x58] = DCR_A;
+  program[0x59] = QUIT;
+  program[0x60] = INR_B;
+  program[0x61] = RET;
+}
+
+TEST_CASE("The control flow graph follows calls and jump tables")
+{
+  uint8_t program[DISPATCH_PROGRAM_SIZE];
+
+  buildDispatchProgram(program);
+
+  SECTION("It splits the reachable code into basic blocks")
+  {
+    ControlFlowGraph graph(program, DISPATCH_PROGRAM_SIZE);
+
+    graph.explore(vector<uint32_t>(1, 0x00));
+
+    REQUIRE(graph.blocks.size() == 6);
+    REQUIRE(graph.blocks[0x00].length == 3);
+    REQUIRE(graph.blocks[0x40].length == 5);
+    REQUIRE(graph.blocks[0x45].length == 8);
+    REQUIRE(graph.blocks[0x60].length == 2);
+    REQUIRE(graph.blocks[0x40].successors == vector<uint32_t>({ 0x60, 0x45 }));
+    REQUIRE(graph.callTargets == set<uint32_t>({ 0x60 }));
+  }
+
+  SECTION("A table loaded in front of PCHL adds its entries")
+  {
+    ControlFlowGraph graph(program, DISPATCH_PROGRAM_SIZE);
+
+    graph.explore(vector<uint32_t>(1, 0x00));
+
+    REQUIRE(graph.jumpTables.size() == 1);
+    REQUIRE(graph.jumpTables[0].address == 0x50);
+    REQUIRE(graph.jumpTables[0].dispatch == 0x45);
+    REQUIRE(graph.jumpTables[0].targets == vector<uint32_t>({ 0x54, 0x58 }));
+    REQUIRE(graph.blocks[0x45].successors == vector<uint32_t>({ 0x54, 0x58 }));
+    REQUIRE(graph.blocks[0x58].length == 2);
+    REQUIRE(graph.leaders.count(0x50) == 0);
+  }
+
+  SECTION("Code outside the image is not followed")
+  {
+    ControlFlowGraph graph(program, 0x45);
+
+    graph.explore(vector<uint32_t>(1, 0x00));
+
+    REQUIRE(graph.leaders.count(0x60) == 1);
+    REQUIRE(graph.blocks.count(0x60) == 0);
+    REQUIRE(graph.jumpTables.empty());
+  }
+}
+
+TEST_CASE("RST goes to its vector and never falls through")
+{
+  uint8_t program[0x44];
+
+  memset(program, NOP, sizeof(program));
+  program[0x08] = DCR_A;
+  program[0x09] = RET;
+  program[0x40] = INR_A;
+  program[0x41] = RST_1;
+  program[0x42] = INR_B;
+  program[0x43] = QUIT;
+
+  ControlFlowGraph graph(program, sizeof(program));
+
+  graph.explore(vector<uint32_t>(1, 0x40));
+
+  REQUIRE(graph.blocks[0x40].length == 2);
+  REQUIRE(graph.blocks[0x40].successors == vector<uint32_t>({ 0x08 }));
+  REQUIRE(graph.callTargets == set<uint32_t>({ 0x08 }));
+  REQUIRE(graph.leaders.count(0x42) == 0);
+  REQUIRE(graph.blocks.count(0x42) == 0);
+}
+
+TEST_CASE("Warming the code decodes blocks before the program runs")
+{
+  uint8_t program[DISPATCH_PROGRAM_SIZE];
+  CPU cpu;
+
+  buildDispatchProgram(program);
+  cpu.loadProgram(program, DISPATCH_PROGRAM_SIZE);
+
+  SECTION("A second warm finds every block already decoded")
+  {
+    REQUIRE(cpu.warmCode() > 0);
+    REQUIRE(cpu.warmCode() == 0);
+  }
+
+  SECTION("The warmed program runs as before")
+  {
+    cpu.warmCode();
+    cpu.processProgram();
+
+    REQUIRE(cpu.registerA == 0x02);
+    REQUIRE(cpu.registerB == 0x01);
+    REQUIRE(cpu.programCounter == 0x55);
+  }
+}
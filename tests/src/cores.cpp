@@ -0,0 +1,600 @@
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/io.h"
+#include "../../src/op_codes.h"
+#include "../../src/space_invaders.h"
+#include "../../src/static_code.h"
+
+#define STATIC_TEST_PROGRAM_SIZE 272
+
+// Recompiled from tests/data/static_program.bin by the Makefile.
+extern const StaticProgram staticTestProgram;
+
+using namespace Catch;
+
+void requireSameState(CPU &reference, CPU &cpu)
+{
+  REQUIRE(cpu.registerA == reference.registerA);
+  REQUIRE(cpu.registerB == reference.registerB);
+  REQUIRE(cpu.registerC == reference.registerC);
+  REQUIRE(cpu.registerD == reference.registerD);
+  REQUIRE(cpu.registerE == reference.registerE);
+  REQUIRE(cpu.registerH == reference.registerH);
+  REQUIRE(cpu.registerL == reference.registerL);
+  REQUIRE(cpu.status == reference.status);
+  REQUIRE(cpu.stackPointer == reference.stackPointer);
+  REQUIRE(cpu.programCounter == reference.programCounter);
+  REQUIRE(cpu.elapsedCycles() == reference.elapsedCycles());
+  REQUIRE(cpu.memory == reference.memory);
+}
+
+// Runs program to the end on both CPUs and compares them.
+void requireSameRun(CPU &reference, CPU &cpu, uint8_t *program, uint16_t size)
+{
+  reference.loadProgram(program, size);
+  cpu.loadProgram(program, size);
+
+  reference.processProgram();
+  cpu.processProgram();
+
+  requireSameState(reference, cpu);
+}
+
+// Steps both CPUs through program and compares them after every instruction.
+void requireSameSteps(CPU &reference, CPU &cpu, uint8_t *program, uint16_t size)
+{
+  reference.stepThrough = true;
+  cpu.stepThrough = true;
+  reference.loadProgram(program, size);
+  cpu.loadProgram(program, size);
+
+  while (reference.runProgram)
+  {
+    reference.processProgram();
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+  }
+}
+
+TEST_CASE("Every CPU core matches the switch core")
+{
+  // cpu runs on the core picked with --core, and 'make run_tests' runs the
+  // suite once for each core.
+  uint8_t program[48] = {
+    LXI_SP, 0x00, 0x20, LXI_H, 0x00, 0x10, MVI_B, 0x05, MVI_A, 0x10,
+    ADD_B, MOV_M_A, INX_H, CALL, 40, 0, DCR_B, JNZ, 10, 0,
+    PUSH_PSW, POP_D, XCHG, DAD_D, CPI, 0x33, CNC, 44, 0, SBI,
+    0x01, RAL, DAA, STA, 0x00, 0x11, QUIT, NOP, NOP, NOP,
+    INR_C, ORA_A, RNZ, RET, INR_D, CMC, RC, RET
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+
+  SECTION("It runs a program to the same state and cycle count")
+  {
+    requireSameRun(reference, cpu, program, 48);
+  }
+
+  SECTION("Lazy flag evaluation runs a program to the same state and cycle count")
+  {
+    cpu.lazyFlags = true;
+    requireSameRun(reference, cpu, program, 48);
+  }
+
+  SECTION("It matches the switch core after every step")
+  {
+    requireSameSteps(reference, cpu, program, 48);
+  }
+}
+
+TEST_CASE("With followJumps off every core steps over jumps, calls and returns without charging them")
+{
+  uint8_t program[23] = {
+    MVI_B, 0x02, DCR_B, JNZ, 0x02, 0x00, CPI, 0x00, JZ, 0x00,
+    0x00, CALL, 0x00, 0x00, CNC, 0x00, 0x00, RET, RZ, JMP,
+    0x00, 0x00, QUIT
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+  reference.followJumps = false;
+  cpu.followJumps = false;
+  requireSameRun(reference, cpu, program, 23);
+
+  REQUIRE(reference.programCounter == 22);
+}
+
+TEST_CASE("Fused instruction pairs run the same as the instructions on their own")
+{
+  uint8_t program[47] = {
+    LXI_SP, 0x00, 0x20, LXI_H, 0x00, 0x10, LXI_D, 0x00, 0x11, LXI_B,
+    0x20, 0x12, MVI_A, 0x37, OUT, 0x04, MVI_A, 0x02, OUT, 0x02,
+    MOV_A_M, INX_H, ADD_C, LDX_D, STAX_B, INX_D, MOV_A_C, INX_D, CPI, 0x05,
+    JZ, 0x23, 0x00, NOP, NOP, CPI, 0x10, JNZ, 0x28, 0x00,
+    DCR_C, JNZ, 0x14, 0x00, IN, 0x03, QUIT
+  };
+  SpaceInvaders referenceHardware;
+  SpaceInvaders hardware;
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+  reference.setPortHandler(&referenceHardware);
+  cpu.core = BLOCK_CORE;
+  cpu.setPortHandler(&hardware);
+
+  SECTION("Fused pairs match the switch core")
+  {
+    requireSameRun(reference, cpu, program, 47);
+    REQUIRE(hardware.registerX == referenceHardware.registerX);
+    REQUIRE(hardware.shiftOffset == referenceHardware.shiftOffset);
+  }
+
+  SECTION("Fused pairs match the same pairs unfused")
+  {
+    reference.core = BLOCK_CORE;
+    reference.fuseInstructions = false;
+    requireSameRun(reference, cpu, program, 47);
+  }
+}
+
+TEST_CASE("A threaded core specialised on SpaceInvaders matches the type-erased one")
+{
+  uint8_t program[47] = {
+    LXI_SP, 0x00, 0x20, LXI_H, 0x00, 0x10, LXI_D, 0x00, 0x11, LXI_B,
+    0x20, 0x12, MVI_A, 0x37, OUT, 0x04, MVI_A, 0x02, OUT, 0x02,
+    MOV_A_M, INX_H, ADD_C, LDX_D, STAX_B, INX_D, MOV_A_C, INX_D, IN, 0x03,
+    JZ, 0x23, 0x00, NOP, NOP, CPI, 0x10, JNZ, 0x28, 0x00,
+    DCR_C, JNZ, 0x14, 0x00, IN, 0x03, QUIT
+  };
+  SpaceInvaders referenceHardware;
+  SpaceInvaders hardware;
+  CPU reference;
+  CPU cpu;
+
+  reference.core = THREADED_CORE;
+  reference.setPortHandler(&referenceHardware);
+  reference.loadProgram(program, 47);
+  cpu.core = THREADED_CORE;
+  cpu.setPortHandler<SpaceInvaders, 0>(&hardware);
+  cpu.loadProgram(program, 47);
+
+  // Without test hooks QUIT does not stop the core, so run it for exactly
+  // the cycles the type-erased core took to reach QUIT.
+  reference.processProgram();
+
+  REQUIRE(cpu.runCycles(reference.elapsedCycles()) == 0);
+  requireSameState(reference, cpu);
+  REQUIRE(hardware.registerX == referenceHardware.registerX);
+}
+
+TEST_CASE("The JIT core matches the switch core once its blocks are compiled")
+{
+  uint8_t program[46] = {
+    LXI_SP, 0x00, 0x20, LXI_H, 0x00, 0x10, LXI_D, 0x34, 0x12, MVI_B,
+    0xc8, MOV_A_B, ADD_E, MOV_M_A, INX_H, CMA, MOV_E_A, XCHG, MOV_C_M, INX_H,
+    XCHG, LDX_D, ADD_C, MOV_D_A, DCX_D, INX_D, DCX_D, LDA, 0x05, 0x10,
+    ADD_D, MOV_C_A, PUSH_H, LXLD, 0x02, 0x10, MOV_A_L, ADD_H, ADD_C, MOV_C_A,
+    POP_H, DCR_B, JNZ, 0x0b, 0x00, QUIT
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+  cpu.core = JIT_CORE;
+  cpu.backgroundCompilation = false;
+  requireSameRun(reference, cpu, program, 46);
+}
+
+TEST_CASE("Blocks compiled in the background take over without changing the result")
+{
+  // Adds C to 0x8000 bytes from 0x1000 in a loop that gets hot early, then
+  // patches the ADD C in the loop into SUB C and runs it again, so code that
+  // is still being compiled can be retired under the compiler.
+  uint8_t program[31] = {
+    LXI_SP, 0x00, 0x20, MVI_E, 0x02, LXI_B, 0x00, 0x80, LXI_H, 0x00,
+    0x10, MOV_A_M, ADD_C, MOV_M_A, INX_H, DCX_B, MOV_A_B, ORA_C, JNZ, 0x0b,
+    0x00, MVI_A, SUB_C, STA, 0x0c, 0x00, DCR_E, JNZ, 0x05, 0x00,
+    QUIT
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+  cpu.core = JIT_CORE;
+  cpu.backgroundCompilation = true;
+  requireSameRun(reference, cpu, program, 31);
+}
+
+TEST_CASE("The trace core matches the switch core once its traces are loaded")
+{
+  // Calls a routine that adds C to 0x800 bytes from 0x1000, then patches
+  // the ADD C into SUB C, which drops every trace through page 0, and runs
+  // the loop again.
+  uint8_t program[37] = {
+    LXI_SP, 0x00, 0x20, MVI_E, 0x02, LXI_B, 0x00, 0x08, LXI_H, 0x00,
+    0x10, CALL, 0x20, 0x00, DCX_B, MOV_A_B, ORA_C, JNZ, 0x0b, 0x00,
+    MVI_A, SUB_C, STA, 0x21, 0x00, DCR_E, JNZ, 0x05, 0x00, QUIT,
+    NOP, NOP, MOV_A_M, ADD_C, MOV_M_A, INX_H, RET
+  };
+  CPU reference;
+
+  reference.core = SWITCH_CORE;
+  reference.loadProgram(program, 37);
+  reference.processProgram();
+
+  // The second run loads the traces the first one compiled.
+  for (int run = 0; run < 2; run++)
+  {
+    CPU cpu;
+
+    cpu.core = TRACE_CORE;
+    cpu.backgroundCompilation = false;
+    cpu.traceCacheDirectory = "tests/obj/traces";
+    cpu.loadProgram(program, 37);
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+#ifdef HAS_TRACE_COMPILER
+    REQUIRE(cpu.loadedTraces() > 0);
+#endif
+  }
+}
+
+TEST_CASE("The aot core matches the switch core")
+{
+  // Calls a routine at 0x0100 from static code, patches its NOP into INR A,
+  // then calls it again from code only reachable through PCHL.
+  uint8_t program[STATIC_TEST_PROGRAM_SIZE];
+  CPU reference;
+  CPU cpu;
+
+  REQUIRE(openFile("tests/data/static_program.bin", program, STATIC_TEST_PROGRAM_SIZE) == 0);
+  reference.core = SWITCH_CORE;
+  cpu.core = AOT_CORE;
+  cpu.setStaticProgram(&staticTestProgram);
+
+  SECTION("It runs the recompiled blocks and falls back for patched and unseen code")
+  {
+    reference.loadProgram(program, STATIC_TEST_PROGRAM_SIZE);
+    cpu.loadProgram(program, STATIC_TEST_PROGRAM_SIZE);
+
+    REQUIRE(cpu.runsStaticCode());
+
+    reference.processProgram();
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+  }
+
+  SECTION("A program that differs from the recompiled image runs on the block core")
+  {
+    program[0x42] = 0x23;
+    reference.loadProgram(program, STATIC_TEST_PROGRAM_SIZE);
+    cpu.loadProgram(program, STATIC_TEST_PROGRAM_SIZE);
+
+    REQUIRE(!cpu.runsStaticCode());
+
+    reference.processProgram();
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+  }
+}
+
+TEST_CASE("runCycles runs a cycle budget in one call")
+{
+  uint8_t program[8] = { MVI_B, 0x00, INR_A, DCR_B, JNZ, 0x02, 0x00, QUIT };
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+  reference.stepThrough = true;
+  reference.loadProgram(program, 8);
+  cpu.loadProgram(program, 8);
+
+  SECTION("It returns the cycles run past the budget")
+  {
+    int64_t overshoot = cpu.runCycles(995);
+
+    REQUIRE(overshoot >= 0);
+    REQUIRE(overshoot == (int64_t)cpu.elapsedCycles() - 995);
+  }
+
+  SECTION("The table core stops on the first instruction that reaches the budget")
+  {
+    cpu.core = TABLE_CORE;
+
+    while (reference.elapsedCycles() < 995)
+    {
+      reference.processProgram();
+    }
+
+    REQUIRE(cpu.runCycles(995) == reference.elapsedCycles() - 995);
+    requireSameState(reference, cpu);
+  }
+
+  SECTION("It ignores stepThrough")
+  {
+    cpu.stepThrough = true;
+
+    REQUIRE(cpu.runCycles(100) >= 0);
+    REQUIRE(cpu.elapsedCycles() >= 100);
+  }
+
+  SECTION("It returns early, with a negative overshoot, when the program ends")
+  {
+    reference.stepThrough = false;
+    reference.processProgram();
+
+    REQUIRE(cpu.runCycles(1000000) == (int64_t)reference.elapsedCycles() - 1000000);
+    requireSameState(reference, cpu);
+  }
+
+  SECTION("It skips the rest of the budget on HLT and counts it as idle")
+  {
+    uint8_t halting[3] = { INR_A, HLT, INR_A };
+
+    cpu.loadProgram(halting, 3);
+
+    REQUIRE(cpu.runCycles(1000) == 0);
+    REQUIRE(cpu.registerA == 1);
+    REQUIRE(cpu.halted());
+    REQUIRE(cpu.elapsedCycles() == 1000);
+    REQUIRE(cpu.elapsedIdleCycles() == 1000 - 5 - 7);
+
+    REQUIRE(cpu.runCycles(500) == 0);
+    REQUIRE(cpu.elapsedIdleCycles() == 1500 - 5 - 7);
+  }
+
+  SECTION("An interrupt wakes a halted CPU after the skipped budget")
+  {
+    uint8_t halting[3] = { EI, HLT, QUIT };
+
+    cpu.loadProgram(halting, 3);
+    cpu.runCycles(1000);
+    cpu.handleInterrupt(RST_1);
+    cpu.runCycles(1000);
+
+    REQUIRE(!cpu.halted());
+    REQUIRE(cpu.programCounter == 0x09);
+    REQUIRE(cpu.elapsedIdleCycles() == 1000 - 4 - 7);
+  }
+
+  SECTION("processProgram does not skip ahead on HLT")
+  {
+    uint8_t halting[3] = { INR_A, HLT, INR_A };
+
+    cpu.loadProgram(halting, 3);
+    cpu.processProgram();
+
+    REQUIRE(cpu.elapsedCycles() == 5 + 7);
+    REQUIRE(cpu.elapsedIdleCycles() == 0);
+  }
+}
+
+TEST_CASE("Skipping an idle loop ends in the same state as running it")
+{
+  // Spins on the flag at 0x40 until the RST 2 handler sets it.
+  uint8_t program[0x41] = {
+    LXI_SP, 0x00, 0x01, EI, LDA, 0x40, 0x00, ORA_A, JZ, 0x04,
+    0x00, MVI_B, 0x55, HLT, NOP, NOP, MVI_A, 0x01, STA, 0x40,
+    0x00, EI, RET
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.skipIdleLoops = false;
+  reference.loadProgram(program, 0x41);
+  cpu.loadProgram(program, 0x41);
+
+  for (int frame = 0; frame < 3; frame++)
+  {
+    REQUIRE(cpu.runCycles(1000) == reference.runCycles(1000));
+    requireSameState(reference, cpu);
+  }
+
+  if (cpu.core == BLOCK_CORE || cpu.core == JIT_CORE)
+  {
+    REQUIRE(cpu.elapsedIdleCycles() > 2500);
+  }
+
+  reference.handleInterrupt(RST_2);
+  cpu.handleInterrupt(RST_2);
+
+  REQUIRE(cpu.runCycles(1000) == reference.runCycles(1000));
+  requireSameState(reference, cpu);
+  REQUIRE(cpu.registerB == 0x55);
+  REQUIRE(cpu.halted());
+}
+
+TEST_CASE("Dropping dead flag updates leaves the same state")
+{
+  uint8_t program[28] = {
+    LXI_SP, 0x00, 0x01, MVI_B, 0x7f, MVI_A, 0xf0, INR_B, ADD_B, DCR_C,
+    CMP_A, STC, ADC_B, DAD_D, SUB_C, CMC, ANA_A, XRA_C, ORA_D, PUSH_PSW,
+    INR_E, CPI, 0x10, JZ, 0x1b, 0x00, NOP, QUIT
+  };
+  CPU reference;
+  CPU cpu;
+
+  SECTION("It matches the switch core")
+  {
+    reference.core = SWITCH_CORE;
+    requireSameRun(reference, cpu, program, 28);
+  }
+
+  SECTION("It matches the same block with every flag update kept")
+  {
+    reference.skipDeadFlags = false;
+    requireSameRun(reference, cpu, program, 28);
+  }
+
+  SECTION("A store into the block keeps the flags the overwritten code would have replaced")
+  {
+    // The STA turns the ADD A at 0x0c into a NOP, so PUSH PSW sees the flags of ADD B.
+    uint8_t selfModifying[15] = {
+      LXI_SP, 0x00, 0x01, MVI_B, 0x80, MVI_A, 0x80, ADD_B, STA, 0x0c,
+      0x00, NOP, ADD_A, PUSH_PSW, QUIT
+    };
+
+    reference.core = SWITCH_CORE;
+    requireSameRun(reference, cpu, selfModifying, 15);
+  }
+
+  SECTION("OUT without a port handler keeps the flags set before it")
+  {
+    uint8_t output[7] = { MVI_A, 0x01, DCR_A, OUT, 0x02, INR_A, QUIT };
+
+    cpu.loadProgram(output, 7);
+
+    REQUIRE_THROWS(cpu.processProgram());
+    REQUIRE(cpu.zeroBitSet());
+    REQUIRE(cpu.registerA == 0);
+  }
+}
+
+TEST_CASE("Copy and fill loops end in the same state as running them")
+{
+  // Copies 16 bytes, fills 0x2400-0x3fff up to an end page, fills 256 bytes
+  // from a register, then copies onto the bytes it is reading.
+  uint8_t program[0x50] = {
+    LXI_D, 0x40, 0x00, LXI_H, 0x00, 0x20, MVI_B, 0x10, LDX_D, MOV_M_A,
+    INX_H, INX_D, DCR_B, JNZ, 0x08, 0x00, LXI_H, 0x00, 0x24, MVI_M,
+    0x55, INX_H, MOV_A_H, CPI, 0x40, JNZ, 0x13, 0x00, MVI_C, 0xaa,
+    MVI_B, 0x00, MOV_M_C, INX_H, DCR_B, JNZ, 0x20, 0x00, LXI_D, 0x00,
+    0x20, LXI_H, 0x01, 0x20, MVI_C, 0x08, LDX_D, MOV_M_A, INX_D, INX_H,
+    DCR_C, JNZ, 0x2e, 0x00, QUIT, NOP, NOP, NOP, NOP, NOP,
+    NOP, NOP, NOP, NOP, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10
+  };
+  CPU reference;
+  CPU cpu;
+
+  reference.loadProgram(program, 0x50);
+  cpu.loadProgram(program, 0x50);
+
+  SECTION("They match the switch core")
+  {
+    reference.core = SWITCH_CORE;
+
+    reference.processProgram();
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+    REQUIRE(cpu.memory[0x200f] == 0x10);
+    REQUIRE(cpu.memory[0x3fff] == 0x55);
+    REQUIRE(cpu.memory[0x40ff] == 0xaa);
+    REQUIRE(cpu.memory[0x2008] == 0x01);
+  }
+
+  SECTION("They stop where the budget runs out")
+  {
+    reference.replaceMemoryLoops = false;
+
+    for (int slice = 0; slice < 60; slice++)
+    {
+      REQUIRE(cpu.runCycles(5000) == reference.runCycles(5000));
+      requireSameState(reference, cpu);
+    }
+  }
+}
+
+TEST_CASE("Code written by the program is decoded again before it runs")
+{
+  uint8_t program[19] = {
+    MVI_B, 0x03, MVI_A, INR_D, JMP, 0x07, 0x00, INR_C, DCR_B, JZ,
+    0x12, 0x00, STA, 0x07, 0x00, JMP, 0x07, 0x00, QUIT
+  };
+  CPU cpu;
+
+  cpu.loadProgram(program, 19);
+  cpu.processProgram();
+
+  REQUIRE(cpu.registerC == 1);
+  REQUIRE(cpu.registerD == 2);
+  REQUIRE(cpu.memory[7] == INR_D);
+}
+
+TEST_CASE("Chained blocks and predicted returns end in the same state")
+{
+  // Makes nested calls, and a call whose routine reads the byte after the
+  // CALL and returns past it with PCHL, 0x40 times. Then it patches the
+  // first routine's INR C into DCR C and runs the loop again.
+  uint8_t program[0x36] = {
+    LXI_SP, 0x00, 0x20, MVI_E, 0x02, MVI_B, 0x40, CALL, 0x20, 0x00,
+    CALL, 0x30, 0x00, 0x05, DCR_B, JNZ, 0x07, 0x00, MVI_A, DCR_C,
+    STA, 0x20, 0x00, DCR_E, JNZ, 0x05, 0x00, QUIT, NOP, NOP,
+    NOP, NOP, INR_C, CALL, 0x28, 0x00, RET, NOP, NOP, NOP,
+    ADD_C, MOV_D_A, RET, NOP, NOP, NOP, NOP, NOP, POP_H, MOV_A_M,
+    ADD_D, MOV_D_A, INX_H, PCHL
+  };
+  CPU reference;
+  CPU cpu;
+
+  cpu.chainBlocks = true;
+  reference.loadProgram(program, 0x36);
+  cpu.loadProgram(program, 0x36);
+
+  SECTION("They match the switch core")
+  {
+    reference.core = SWITCH_CORE;
+
+    reference.processProgram();
+    cpu.processProgram();
+
+    requireSameState(reference, cpu);
+  }
+
+  SECTION("They stop where the budget runs out")
+  {
+    reference.chainBlocks = false;
+
+    for (int slice = 0; slice < 30; slice++)
+    {
+      REQUIRE(cpu.runCycles(500) == reference.runCycles(500));
+      requireSameState(reference, cpu);
+    }
+  }
+}
+
+TEST_CASE("Code copied into memory is cached until it is written again")
+{
+  // Copies a counting loop from 0x40 to 0x200 and calls it for 0x800
+  // passes, then patches its ADD E into SUB E and calls it for 0x10 more.
+  uint8_t program[0x300] = {
+    LXI_SP, 0x00, 0x10, LXI_D, 0x40, 0x00, LXI_H, 0x00, 0x02, MVI_B,
+    0x0b, LDX_D, MOV_M_A, INX_H, INX_D, DCR_B, JNZ, 0x0b, 0x00, LXI_B,
+    0x00, 0x08, CALL, 0x00, 0x02, MVI_A, SUB_E, STA, 0x01, 0x02,
+    LXI_B, 0x10, 0x00, CALL, 0x00, 0x02, QUIT
+  };
+  uint8_t routine[11] = { MOV_A_H, ADD_E, MOV_H_A, INR_E, DCX_B, MOV_A_B, ORA_C, JNZ, 0x00, 0x02, RET };
+  CPU reference;
+  CPU cpu;
+
+  memcpy(program + 0x40, routine, sizeof(routine));
+  reference.core = SWITCH_CORE;
+  reference.loadProgram(program, sizeof(program));
+  reference.processProgram();
+
+  cpu.backgroundCompilation = false;
+  cpu.traceCacheDirectory = "tests/obj/traces";
+  cpu.loadProgram(program, sizeof(program));
+  cpu.processProgram();
+
+  requireSameState(reference, cpu);
+  REQUIRE(cpu.memory[0x201] == SUB_E);
+#ifdef HAS_TRACE_COMPILER
+  if (cpu.core == TRACE_CORE)
+  {
+    REQUIRE(cpu.loadedTraces() > 0);
+  }
+#endif
+}
@@ -57,4 +57,19 @@ TEST_CASE("The CPU handles opcodes for operations with direct memory instruction
     REQUIRE(cpu.registerH == 0xe2);
     REQUIRE(cpu.registerL == 0x05);
   }
+
+  SECTION("SHLD and LHLD wrap round to address 0 at the top of memory")
+  {
+    uint8_t program[9] = { SHLD, 0xff, 0xff, LXI_H, 0x00, 0x00, LXLD, 0xff, 0xff };
+    cpu.registerH = 0xae;
+    cpu.registerL = 0x29;
+
+    cpu.loadProgram(program, 9);
+    cpu.processProgram();
+
+    REQUIRE(cpu.memory[0xffff] == 0x29);
+    REQUIRE(cpu.memory[0x0000] == 0xae);
+    REQUIRE(cpu.registerH == 0xae);
+    REQUIRE(cpu.registerL == 0x29);
+  }
 }
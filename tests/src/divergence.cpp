@@ -0,0 +1,86 @@
+#include <string>
+
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/lockstep.h"
+#include "../../src/op_codes.h"
+#include "../../src/space_invaders.h"
+
+// Fills 0x1000-0x13ff with a counter forever, while RST 1 counts in D and
+// RST 2 counts in E.
+#define LOCKSTEP_PROGRAM_SIZE 0x28
+
+uint8_t lockstepProgram[LOCKSTEP_PROGRAM_SIZE] = {
+  LXI_SP, 0x00, 0x20, EI, JMP, 0x18, 0x00, NOP, INR_D, EI,
+  RET, NOP, NOP, NOP, NOP, NOP, INR_E, EI, RET, NOP,
+  NOP, NOP, NOP, NOP, LXI_H, 0x00, 0x10, INR_B, MOV_M_B, INX_H,
+  MOV_A_H, CPI, 0x14, JNZ, 0x1b, 0x00, JMP, 0x18, 0x00, NOP
+};
+
+TEST_CASE("Lockstep runs a core next to the switch core")
+{
+  SpaceInvaders referenceHardware;
+  SpaceInvaders hardware;
+  CPU reference;
+  CPU cpu;
+  Lockstep lockstep(&reference, &cpu);
+
+  reference.core = SWITCH_CORE;
+  reference.setPortHandler(&referenceHardware);
+  reference.loadProgram(lockstepProgram, LOCKSTEP_PROGRAM_SIZE);
+  referenceHardware.startScreenInterrupts(&reference);
+  cpu.setPortHandler(&hardware);
+  cpu.loadProgram(lockstepProgram, LOCKSTEP_PROGRAM_SIZE);
+  hardware.startScreenInterrupts(&cpu);
+
+  SECTION("Cores that agree run to the end with the same interrupts")
+  {
+    REQUIRE(lockstep.runUntil(200000) >= 0);
+    REQUIRE(!lockstep.diverged());
+    REQUIRE(lockstep.divergence() == "");
+    REQUIRE(cpu.elapsedCycles() == reference.elapsedCycles());
+    REQUIRE(cpu.registerD == 6);
+    REQUIRE(cpu.registerE == 5);
+    REQUIRE(reference.registerD == 6);
+    REQUIRE(reference.registerE == 5);
+  }
+
+  SECTION("It stops at the first check where the cores disagree")
+  {
+    cpu.memory[0x1b] = INR_C;
+    cpu.invalidateCode();
+
+    REQUIRE(lockstep.runUntil(200000) < 0);
+    REQUIRE(lockstep.diverged());
+    REQUIRE(lockstep.divergenceCycle() == cpu.elapsedCycles());
+    REQUIRE(lockstep.divergenceCycle() < 2 * DEFAULT_LOCKSTEP_INTERVAL);
+    REQUIRE(lockstep.divergence().find("register B is 0x00 on the " + CPU::nameOfCore(cpu.core) + " core") != string::npos);
+  }
+
+  SECTION("A fault on both cores is not a divergence")
+  {
+    cpu.memory[0x1b] = 0x20;
+    cpu.invalidateCode();
+    reference.memory[0x1b] = 0x20;
+    reference.invalidateCode();
+
+    REQUIRE(lockstep.runUntil(200000) < 0);
+    REQUIRE(!lockstep.diverged());
+    REQUIRE(cpu.fault() == UNHANDLED_OP_CODE_FAULT);
+    REQUIRE(reference.fault() == UNHANDLED_OP_CODE_FAULT);
+    REQUIRE(cpu.programCounter == 0x1c);
+    REQUIRE(reference.programCounter == 0x1c);
+  }
+
+  SECTION("A shorter interval narrows down where it happened")
+  {
+    cpu.memory[0x1000] = 0xff;
+    lockstep.checkInterval = 1;
+
+    lockstep.runUntil(200000);
+
+    REQUIRE(lockstep.diverged());
+    REQUIRE(lockstep.divergence().find("memory at 0x1000 is 0xff") != string::npos);
+  }
+}
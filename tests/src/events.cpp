@@ -0,0 +1,98 @@
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/op_codes.h"
+#include "../../src/space_invaders.h"
+
+using namespace Catch;
+
+class EventRecorder : public EventHandler
+{
+  public:
+    vector<uint8_t> events;
+    vector<uint64_t> cycles;
+    vector<uint64_t> scheduledCycles;
+
+    virtual void handleEvent(CPU *cpu, uint8_t event, uint64_t cycle)
+    {
+      events.push_back(event);
+      cycles.push_back(cpu->elapsedCycles());
+      scheduledCycles.push_back(cycle);
+    }
+};
+
+TEST_CASE("Scheduled events")
+{
+  uint8_t program[4] = { NOP, JMP, 0x00, 0x00 };
+  EventRecorder recorder;
+  CPU cpu;
+
+  cpu.loadProgram(program, 4);
+
+  SECTION("Events run in cycle order, once the counter reaches them")
+  {
+    cpu.scheduleEvent(300, &recorder, 2);
+    cpu.scheduleEvent(100, &recorder, 1);
+    cpu.scheduleEvent(300, &recorder, 3);
+
+    REQUIRE(cpu.nextEventCycle() == 100);
+    REQUIRE(cpu.runUntil(1000) >= 0);
+    REQUIRE(recorder.events.size() == 3);
+    REQUIRE(recorder.events[0] == 1);
+    REQUIRE(recorder.events[1] == 2);
+    REQUIRE(recorder.events[2] == 3);
+    REQUIRE(recorder.scheduledCycles[0] == 100);
+    REQUIRE(recorder.cycles[0] >= 100);
+    REQUIRE(recorder.cycles[0] < 100 + 14);
+    REQUIRE(recorder.cycles[1] >= 300);
+    REQUIRE(cpu.nextEventCycle() == NO_EVENT);
+  }
+
+  SECTION("Events after the target stay pending")
+  {
+    cpu.scheduleEvent(5000, &recorder, 1);
+    cpu.runUntil(1000);
+
+    REQUIRE(recorder.events.empty());
+    REQUIRE(cpu.nextEventCycle() == 5000);
+
+    cpu.cancelEvents(&recorder);
+
+    REQUIRE(cpu.nextEventCycle() == NO_EVENT);
+  }
+
+  SECTION("The cycle counter does not wrap at 32 bits")
+  {
+    uint8_t halting[1] = { HLT };
+
+    cpu.loadProgram(halting, 1);
+    cpu.runUntil(5000000000ULL);
+
+    REQUIRE(cpu.elapsedCycles() >= 5000000000ULL);
+  }
+}
+
+TEST_CASE("A halted CPU skips to the next event")
+{
+  uint8_t program[3] = { EI, HLT, QUIT };
+  SpaceInvaders hardware;
+  CPU cpu;
+
+  cpu.loadProgram(program, 3);
+  hardware.startScreenInterrupts(&cpu);
+  cpu.runUntil(CYCLES_PER_SCREEN_INTERRUPT - 1);
+
+  REQUIRE(cpu.halted());
+  REQUIRE(cpu.elapsedCycles() == CYCLES_PER_SCREEN_INTERRUPT - 1);
+  REQUIRE(cpu.elapsedIdleCycles() == CYCLES_PER_SCREEN_INTERRUPT - 1 - 4 - 7);
+
+  cpu.runUntil(CYCLES_PER_SCREEN_INTERRUPT);
+
+  // RST 1 woke the CPU and sent it to 0x08, past the end of the program.
+  REQUIRE(!cpu.halted());
+  REQUIRE(cpu.nextEventCycle() == 2 * CYCLES_PER_SCREEN_INTERRUPT);
+  REQUIRE(cpu.stackPointer == 0xfffe);
+  REQUIRE(cpu.memory[0xfffe] == 2);
+}
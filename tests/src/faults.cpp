@@ -0,0 +1,125 @@
+#include <stdexcept>
+
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/op_codes.h"
+#include "../../src/unhandled_op_code_exception.h"
+
+using namespace Catch;
+
+TEST_CASE("A fault stops the CPU without an exception")
+{
+  CPU cpu;
+
+  SECTION("An unhandled op code is stepped over and stops runCycles")
+  {
+    uint8_t program[4] = { INR_A, 0x20, INR_A, QUIT };
+
+    cpu.loadProgram(program, 4);
+
+    REQUIRE(cpu.runCycles(1000) < 0);
+    REQUIRE(cpu.fault() == UNHANDLED_OP_CODE_FAULT);
+    REQUIRE(cpu.faultMessage() == "Unhandled Op Code: 0x20");
+    REQUIRE(cpu.registerA == 1);
+    REQUIRE(cpu.programCounter == 2);
+    REQUIRE(cpu.elapsedCycles() == 5);
+  }
+
+  SECTION("IN without a port handler leaves A alone and ends the block")
+  {
+    uint8_t program[6] = { MVI_A, 0x05, IN, 0x01, INR_A, QUIT };
+
+    cpu.loadProgram(program, 6);
+
+    REQUIRE(cpu.runCycles(1000) < 0);
+    REQUIRE(cpu.fault() == NO_INPUT_PORT_HANDLER_FAULT);
+    REQUIRE(cpu.faultMessage() == "No input port handler attached!");
+    REQUIRE(cpu.registerA == 0x05);
+    REQUIRE(cpu.programCounter == 4);
+    REQUIRE(cpu.elapsedCycles() == 7 + 10);
+  }
+
+  SECTION("OUT without a port handler stops the CPU")
+  {
+    uint8_t program[4] = { OUT, 0x02, INR_A, QUIT };
+
+    cpu.loadProgram(program, 4);
+
+    REQUIRE(cpu.runCycles(1000) < 0);
+    REQUIRE(cpu.fault() == NO_OUTPUT_PORT_HANDLER_FAULT);
+    REQUIRE(cpu.registerA == 0);
+    REQUIRE(cpu.programCounter == 2);
+  }
+
+  SECTION("A push below stackLimit is dropped")
+  {
+    uint8_t program[7] = { LXI_SP, 0x00, 0x20, PUSH_B, PUSH_B, INR_A, QUIT };
+
+    cpu.stackLimit = 0x1ffe;
+    cpu.loadProgram(program, 7);
+
+    REQUIRE(cpu.runCycles(1000) < 0);
+    REQUIRE(cpu.fault() == STACK_OVERFLOW_FAULT);
+    REQUIRE(cpu.faultMessage() == "Stack overflow!");
+    REQUIRE(cpu.stackPointer == 0x1ffe);
+    REQUIRE(cpu.registerA == 0);
+    REQUIRE(cpu.programCounter == 5);
+  }
+
+  SECTION("A call at the bottom of memory wraps round to the top instead")
+  {
+    uint8_t program[7] = { LXI_SP, 0x01, 0x00, CALL, 0x06, 0x00, QUIT };
+
+    cpu.loadProgram(program, 7);
+
+    REQUIRE(cpu.runCycles(1000) < 0);
+    REQUIRE(cpu.fault() == NO_FAULT);
+    REQUIRE(cpu.stackPointer == 0xffff);
+    REQUIRE(cpu.memory[0xffff] == 0x06);
+    REQUIRE(cpu.memory[0x0000] == 0x00);
+  }
+
+  SECTION("The fault is sticky until it is cleared")
+  {
+    uint8_t program[4] = { INR_A, 0x20, INR_A, QUIT };
+
+    cpu.loadProgram(program, 4);
+    cpu.runCycles(1000);
+
+    REQUIRE(cpu.runCycles(1000) == -1000);
+    REQUIRE(cpu.runUntil(cpu.elapsedCycles() + 1000) == -1000);
+    REQUIRE(cpu.registerA == 1);
+
+    cpu.clearFault();
+    cpu.runCycles(1000);
+
+    REQUIRE(cpu.fault() == NO_FAULT);
+    REQUIRE(cpu.registerA == 2);
+    REQUIRE(!cpu.runProgram);
+  }
+
+  SECTION("processProgram throws the fault, and keeps throwing it")
+  {
+    uint8_t program[2] = { IN, 0x01 };
+
+    cpu.loadProgram(program, 2);
+
+    REQUIRE_THROWS_AS(cpu.processProgram(), runtime_error);
+    REQUIRE_THROWS_WITH(cpu.processProgram(), Contains("No input port handler attached!"));
+    REQUIRE(cpu.programCounter == 2);
+  }
+
+  SECTION("Loading a program clears the fault")
+  {
+    uint8_t program[1] = { 0x20 };
+
+    cpu.loadProgram(program, 1);
+
+    REQUIRE_THROWS_AS(cpu.processProgram(), UnhandledOpCodeException);
+
+    cpu.loadProgram(program, 1);
+
+    REQUIRE(cpu.fault() == NO_FAULT);
+  }
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/op_codes.h"
+#include "../../src/status_bits.h"
+
+using namespace Catch;
+
+// The one-instruction program is loaded once, since loading it again would
+// throw away the code the block cores decoded. Each run starts it over.
+bool sameResultAsSwitchCore(CPU &reference, CPU &cpu, uint8_t accumulator, uint8_t operand, uint8_t flags)
+{
+  reference.programCounter = 0;
+  reference.registerA = accumulator;
+  reference.registerB = operand;
+  reference.status = 0x02 | flags;
+  reference.processProgram();
+
+  cpu.programCounter = 0;
+  cpu.registerA = accumulator;
+  cpu.registerB = operand;
+  cpu.status = 0x02 | flags;
+  cpu.processProgram();
+
+  return cpu.registerA == reference.registerA && cpu.registerB == reference.registerB && cpu.status == reference.status;
+}
+
+TEST_CASE("The flags match the switch core for every operand")
+{
+  CPU reference;
+  CPU cpu;
+
+  reference.core = SWITCH_CORE;
+
+  SECTION("Accumulator operations set the same result and flags")
+  {
+    uint8_t opCodes[8] = { ADD_B, ADC_B, SUB_B, SBB_B, ANA_B, XRA_B, ORA_B, CMP_B };
+    int mismatches = 0;
+
+    for (int op = 0; op < 8; op++)
+    {
+      reference.loadProgram(&opCodes[op], 1);
+      cpu.loadProgram(&opCodes[op], 1);
+
+      for (int a = 0; a < 256; a++)
+      {
+        for (int b = 0; b < 256; b++)
+        {
+          mismatches += sameResultAsSwitchCore(reference, cpu, a, b, 0) ? 0 : 1;
+          mismatches += sameResultAsSwitchCore(reference, cpu, a, b, CARRY_BIT | AUXILIARY_CARRY_BIT) ? 0 : 1;
+        }
+      }
+    }
+
+    REQUIRE(mismatches == 0);
+  }
+
+  SECTION("INR, DCR and DAA set the same result and flags")
+  {
+    uint8_t opCodes[3] = { INR_B, DCR_B, DAA };
+    uint8_t flags[4] = { 0, CARRY_BIT, AUXILIARY_CARRY_BIT, CARRY_BIT | AUXILIARY_CARRY_BIT };
+    int mismatches = 0;
+
+    for (int op = 0; op < 3; op++)
+    {
+      reference.loadProgram(&opCodes[op], 1);
+      cpu.loadProgram(&opCodes[op], 1);
+
+      for (int value = 0; value < 256; value++)
+      {
+        for (int f = 0; f < 4; f++)
+        {
+          mismatches += sameResultAsSwitchCore(reference, cpu, value, value, flags[f]) ? 0 : 1;
+        }
+      }
+    }
+
+    REQUIRE(mismatches == 0);
+  }
+}
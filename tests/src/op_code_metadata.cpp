@@ -0,0 +1,97 @@
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "../../src/cpu.h"
+#include "../../src/op_code_info.h"
+#include "../../src/op_codes.h"
+
+using namespace Catch;
+
+TEST_CASE("Op code metadata")
+{
+  SECTION("Each mnemonic takes an operand that matches the instruction length")
+  {
+    for (int opCode = 0; opCode < 256; opCode++)
+    {
+      const OpCodeInfo &info = opCodeInfo(opCode);
+
+      INFO("op code " << opCode << " " << info.mnemonic);
+      REQUIRE((strstr(info.mnemonic, "%04x") != NULL) == (info.length == 3));
+      REQUIRE((strstr(info.mnemonic, "%02x") != NULL) == (info.length == 2));
+      REQUIRE(info.takenCycles >= info.cycles);
+    }
+  }
+
+  SECTION("Only conditional CALL and RET cost more when taken")
+  {
+    REQUIRE(opCodeInfo(CNZ).cycles == 11);
+    REQUIRE(opCodeInfo(CNZ).takenCycles == 17);
+    REQUIRE(opCodeInfo(RC).cycles == 5);
+    REQUIRE(opCodeInfo(RC).takenCycles == 11);
+    REQUIRE(opCodeInfo(JNZ).takenCycles == opCodeInfo(JNZ).cycles);
+    REQUIRE(opCodeInfo(CALL).takenCycles == opCodeInfo(CALL).cycles);
+  }
+
+  SECTION("Traps leave the program counter on the op code")
+  {
+    REQUIRE(interpreterLength(QUIT) == 0);
+    REQUIRE(interpreterLength(RST_3) == 0);
+    REQUIRE(interpreterLength(0xcb) == 0);
+    REQUIRE(interpreterCycles(RST_3) == 0);
+    REQUIRE(opCodeInfo(RST_3).cycles == 11);
+    REQUIRE(interpreterLength(LXI_H) == 3);
+  }
+
+  SECTION("Instructions are disassembled with their operands")
+  {
+    uint8_t program[8] = { MVI_B, 0x2a, JNZ, 0x34, 0x12, MOV_A_M, OUT, 0x03 };
+    char text[32];
+
+    REQUIRE(disassembleInstruction(program, text, sizeof(text)) == 2);
+    REQUIRE(string(text) == "MVI B,0x2a");
+    REQUIRE(disassembleInstruction(program + 2, text, sizeof(text)) == 3);
+    REQUIRE(string(text) == "JNZ 0x1234");
+    REQUIRE(disassembleInstruction(program + 5, text, sizeof(text)) == 1);
+    REQUIRE(string(text) == "MOV A,M");
+    REQUIRE(disassembleInstruction(program + 6, text, sizeof(text)) == 2);
+    REQUIRE(string(text) == "OUT 0x03");
+  }
+}
+
+TEST_CASE("Conditional CALL and RET cycles come from the metadata")
+{
+  CPU cpu;
+
+  SECTION("A taken conditional call costs its taken cycles")
+  {
+    uint8_t program[5] = { STC, CC, 0x00, 0x10, QUIT };
+
+    cpu.loadProgram(program, 5);
+    cpu.processProgram();
+
+    REQUIRE(cpu.programCounter == 0x1000);
+    REQUIRE(cpu.elapsedCycles() == opCodeInfo(STC).cycles + opCodeInfo(CC).takenCycles);
+  }
+
+  SECTION("A conditional call that is not taken costs its base cycles")
+  {
+    uint8_t program[4] = { CC, 0x00, 0x10, QUIT };
+
+    cpu.loadProgram(program, 4);
+    cpu.processProgram();
+
+    REQUIRE(cpu.elapsedCycles() == opCodeInfo(CC).cycles);
+  }
+
+  SECTION("A taken conditional return costs its taken cycles")
+  {
+    uint8_t program[7] = { LXI_SP, 0x05, 0x00, STC, RC, 0x00, 0x10 };
+
+    cpu.loadProgram(program, 7);
+    cpu.processProgram();
+
+    REQUIRE(cpu.programCounter == 0x1000);
+    REQUIRE(cpu.elapsedCycles() == opCodeInfo(LXI_SP).cycles + opCodeInfo(STC).cycles + opCodeInfo(RC).takenCycles);
+  }
+}
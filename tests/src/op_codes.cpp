@@ -27,7 +27,7 @@ TEST_CASE("Running all the opcodes")
     const uint8_t NUM_2BYTE_OP_CODES = 15;
     uint8_t twoByteOpProgram[NUM_2BYTE_OP_CODES * 2] = { MVI_B, 0, MVI_C, 0, MVI_D, 0, MVI_E, 0, MVI_H, 0, MVI_L, 0, MVI_M, 0, MVI_A, 0, ADI, 0, ACI, 0, SUI, 0, ANI, 0, XRI, 0, ORI, 0, CPI, 0 };
 
-    cpu.loadProgram(twoByteOpProgram, 2 * NUM_3BYTE_OP_CODES);
+    cpu.loadProgram(twoByteOpProgram, 2 * NUM_2BYTE_OP_CODES);
     cpu.processProgram();
 
     REQUIRE(1 == 1);
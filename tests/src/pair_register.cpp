@@ -142,7 +142,7 @@ TEST_CASE("The CPU handles opcodes for operations on register pairs correctly")
     cpu.loadProgram(program, 1);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
   }
 
   SECTION("A program can decrement a 16-bit register pair")
@@ -203,6 +203,35 @@ TEST_CASE("The CPU handles opcodes for operations on register pairs correctly")
     REQUIRE(cpu.memory[0x10ae] == 0x0b);
   }
 
+  SECTION("XTHL wraps round to address 0 at the top of memory")
+  {
+    uint8_t program[2] = { XTHL, NOP };
+    cpu.registerH = 0x0b;
+    cpu.registerL = 0x3c;
+    cpu.stackPointer = 0xffff;
+    cpu.memory[0xffff] = 0x51;
+
+    cpu.loadProgram(program, 2);
+    cpu.processProgram();
+
+    REQUIRE(cpu.registerH == XTHL);
+    REQUIRE(cpu.registerL == 0x51);
+    REQUIRE(cpu.memory[0xffff] == 0x3c);
+    REQUIRE(cpu.memory[0x0000] == 0x0b);
+  }
+
+  SECTION("The first POP after a reset reads the word at address 0")
+  {
+    uint8_t program[2] = { POP_B, 0x12 };
+
+    cpu.loadProgram(program, 2);
+    cpu.processProgram();
+
+    REQUIRE(cpu.registerB == 0x12);
+    REQUIRE(cpu.registerC == POP_B);
+    REQUIRE(cpu.stackPointer == 0x0002);
+  }
+
   SECTION("A program can replace the stack pointer with the HL register pair")
   {
     uint8_t program[1] = { SPHL };
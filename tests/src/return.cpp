@@ -16,7 +16,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 8);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerB == 3);
     REQUIRE(!cpu.runProgram);
   }
@@ -28,7 +28,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 8);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerC == 2);
     REQUIRE(!cpu.runProgram);
   }
@@ -52,7 +52,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 7);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerD == 2);
     REQUIRE(!cpu.runProgram);
   }
@@ -76,7 +76,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 8);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerE == 1);
     REQUIRE(!cpu.runProgram);
   }
@@ -100,7 +100,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 7);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerB == 2);
     REQUIRE(!cpu.runProgram);
   }
@@ -124,7 +124,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 7);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerC == 0);
     REQUIRE(!cpu.runProgram);
   }
@@ -148,7 +148,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 7);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerD == 2);
     REQUIRE(!cpu.runProgram);
   }
@@ -172,7 +172,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 9);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerE == 4);
     REQUIRE(!cpu.runProgram);
   }
@@ -196,7 +196,7 @@ TEST_CASE("Testing return op codes")
     cpu.loadProgram(program, 7);
     cpu.processProgram();
 
-    REQUIRE(cpu.stackPointer == 0x10000);
+    REQUIRE(cpu.stackPointer == 0x0000);
     REQUIRE(cpu.registerB == 0x02);
     REQUIRE(!cpu.runProgram);
   }